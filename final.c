@@ -1,379 +1,1045 @@
-#include <pthread.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <unistd.h> // for sleep()
-
-#define MEMORY_SIZE 1024
-#define MAX_PROCESSES 20
-
-typedef struct {
-    int id;
-    int size;
-    int allocated;
-    int start_address;
-    int arrival_time;
-    int execution_time;
-    int remaining_time;
-} Process;
-
-typedef struct FreeBlock {
-    int start;
-    int size;
-    struct FreeBlock *next;
-} FreeBlock;
-
-// Global Variables
-Process processes[MAX_PROCESSES];
-Process waiting_queue[MAX_PROCESSES];
-int waiting_count = 0;
-FreeBlock *freeList = NULL;
-int total_used_memory = 0;
-
-void initialize_memory();
-void allocate_memory(Process *p, int num_processes);
-void deallocate_memory(int process_id, int num_processes);
-void display_memory_state();
-void display_process_table(int num_processes);
-void save_memory_state();
-void merge_free_blocks();
-void calculate_process_stats(int num_processes);
-void tick(int *num_processes);
-void display_waiting_queue();
-void* clock_tick_thread();
-int process_entry_number = 1;
-
-
-
-int main() {
-    int num_processes = 0;
-    initialize_memory();
-    int choice;
-    // int clock_tick_counter = 0;
-    pthread_t tid;
-    pthread_create(&tid, NULL, clock_tick_thread, (void *)&num_processes);
-
-    printf("\n--- Welcome to Dynamic Partitioning Memory Manager ---\n");
-
-    while (1) {
-        // printf("\n==============================\n");
-        // printf("🕰️  Clock Tick: %d\n", clock_tick_counter);
-        // printf("==============================\n");
-        printf("\nChoose an option:\n");
-        printf("1. Add New Process\n");
-        printf("2. Show Process Table\n");
-        printf("3. Show Waiting Queue\n");
-        printf("4. Show Memory Statistics\n");
-        printf("5. Exit\n");
-        printf("Enter your choice: ");
-        scanf("%d", &choice);
-
-        // sleep(1);  // simulate time passing
-        // tick(&num_processes);
-        // clock_tick_counter++;
-
-        switch (choice) {
-            case 1: {
-                if (total_used_memory < MEMORY_SIZE) {
-                    printf("\nEnter process ID, memory size (KB), arrival time, and execution time for process %d (or enter -1 to cancel): ", process_entry_number);
-                    int id, size, arrival_time, execution_time;
-                    scanf("%d", &id);
-                    if (id == -1) break;
-                    scanf("%d %d %d", &size, &arrival_time, &execution_time);
-
-                    if (size > (MEMORY_SIZE - total_used_memory)) {
-                        printf("Memory full! Process %d is added to waiting queue.\n", id);
-                        waiting_queue[waiting_count].id = id;
-                        waiting_queue[waiting_count].size = size;
-                        waiting_queue[waiting_count].arrival_time = arrival_time;
-                        waiting_queue[waiting_count].execution_time = execution_time;
-                        waiting_queue[waiting_count].remaining_time = execution_time;
-                        waiting_queue[waiting_count].allocated = 0;
-                        waiting_queue[waiting_count].start_address = -1;
-                        waiting_count++;
-                        process_entry_number++;
-                        break;
-                    }
-
-                    processes[num_processes].id = id;
-                    processes[num_processes].size = size;
-                    processes[num_processes].arrival_time = arrival_time;
-                    processes[num_processes].execution_time = execution_time;
-                    processes[num_processes].remaining_time = execution_time;
-                    processes[num_processes].allocated = 0;
-                    processes[num_processes].start_address = -1;
-
-                    allocate_memory(&processes[num_processes], num_processes);
-                    total_used_memory += size;
-                    calculate_process_stats(num_processes + 1);
-                    num_processes++;
-                    process_entry_number++;
-                } else {
-                    printf("Memory Full! Cannot add process right now.\n");
-                }
-                break;
-            }
-            case 2:
-                display_process_table(num_processes);
-                break;
-            case 3:
-                display_waiting_queue();
-                break;
-            case 4:
-                calculate_process_stats(num_processes);
-                break;
-            case 5:
-                printf("\nExiting Memory Manager. Final memory state:\n");
-                display_memory_state();
-                display_process_table(num_processes);
-                exit(0);
-            default:
-                printf("Invalid choice. Please try again!\n");
-        }
-    }
-}
-
-
-// Functions
-
-void initialize_memory() {
-    freeList = (FreeBlock *)malloc(sizeof(FreeBlock));
-    freeList->start = 0;
-    freeList->size = MEMORY_SIZE;
-    freeList->next = NULL;
-}
-
-void allocate_memory(Process *p, int num_processes) {
-    FreeBlock *best_fit = NULL, *prev = NULL, *current = freeList, *best_prev = NULL;
-
-    while (current) {
-        if (current->size >= p->size) {
-            if (!best_fit || current->size < best_fit->size) {
-                best_fit = current;
-                best_prev = prev;
-            }
-        }
-        prev = current;
-        current = current->next;
-    }
-
-    if (!best_fit) {
-        printf("Process %d (Size: %d KB) cannot be allocated! Not enough memory.\n", p->id, p->size);
-        return;
-    }
-
-    p->start_address = best_fit->start;
-    p->allocated = 1;
-    best_fit->start += p->size;
-    best_fit->size -= p->size;
-
-    if (best_fit->size == 0) {
-        if (best_prev)
-            best_prev->next = best_fit->next;
-        else
-            freeList = best_fit->next;
-        free(best_fit);
-    }
-
-    printf("Process %d allocated at Address: %d KB\n", p->id, p->start_address);
-    display_memory_state();
-    save_memory_state();
-    display_process_table(num_processes + 1);
-}
-
-void deallocate_memory(int process_id, int num_processes) {
-    int found = 0, freed_size = 0, start_address = -1;
-
-    for (int i = 0; i < num_processes; i++) {
-        if (processes[i].id == process_id && processes[i].allocated) {
-            start_address = processes[i].start_address;
-            freed_size = processes[i].size;
-            processes[i].allocated = 0;
-            processes[i].start_address = -1;
-            found = 1;
-            break;
-        }
-    }
-
-    if (!found) {
-        printf("Process %d not found in memory.\n", process_id);
-        return;
-    }
-
-    FreeBlock *new_block = (FreeBlock *)malloc(sizeof(FreeBlock));
-    new_block->start = start_address;
-    new_block->size = freed_size;
-    new_block->next = freeList;
-    freeList = new_block;
-
-    printf("Process %d deallocated, Freed %d KB\n", process_id, freed_size);
-    merge_free_blocks();
-    display_memory_state();
-    save_memory_state();
-}
-
-void merge_free_blocks() {
-    FreeBlock *current = freeList, *next;
-    while (current && current->next) {
-        next = current->next;
-        if (current->start + current->size == next->start) {
-            current->size += next->size;
-            current->next = next->next;
-            free(next);
-        } else {
-            current = current->next;
-        }
-    }
-}
-
-void display_memory_state() {
-    printf("\nCurrent Memory State:\n");
-    FreeBlock *current = freeList;
-    while (current) {
-        printf("[ Free: %d KB at %d KB ] ", current->size, current->start);
-        current = current->next;
-    }
-    printf("\n");
-}
-
-void display_process_table(int num_processes) {
-    printf("\nProcess Table:\n");
-    printf("+------------+----------+--------------+--------------+--------------+--------------+------------+\n");
-    printf("| Process ID |  Size KB | Start Address | Arrival Time | Exec Time(s) | Remaining(s) | Allocated  |\n");
-    printf("+------------+----------+--------------+--------------+--------------+--------------+------------+\n");
-
-    for (int i = 0; i < num_processes; i++) {
-        printf("| %10d | %8d | %12d | %12d | %12d | %12d | %10s |\n",
-               processes[i].id,
-               processes[i].size,
-               processes[i].start_address,
-               processes[i].arrival_time,
-               processes[i].execution_time,
-               processes[i].remaining_time,
-               processes[i].allocated ? "YES" : "NO");
-    }
-
-    printf("+------------+----------+--------------+--------------+--------------+--------------+------------+\n");
-}
-
-
-void save_memory_state() {
-    FILE *file = fopen("memory_state.txt", "w");
-    if (!file) {
-        printf("Error opening file!\n");
-        return;
-    }
-
-    fprintf(file, "Memory State:\n");
-    if (freeList == NULL) {
-        fprintf(file, "No free memory available. All memory is allocated.\n");
-    } else {
-        FreeBlock *current = freeList;
-        while (current) {
-            fprintf(file, "[ Free: %d KB at %d KB ]\n", current->size, current->start);
-            current = current->next;
-        }
-    }
-
-    fclose(file);
-    printf("Memory state saved to 'memory_state.txt'\n");
-}
-
-void calculate_process_stats(int num_processes) {
-    if (num_processes == 0) return;
-
-    int total_size = 0, min_size = 999999, max_size = 0;
-    int used_memory = 0;
-    int allocated_processes = 0;
-
-    for (int i = 0; i < num_processes; i++) {
-        if (processes[i].allocated) {
-            total_size += processes[i].size;
-            if (processes[i].size < min_size) min_size = processes[i].size;
-            if (processes[i].size > max_size) max_size = processes[i].size;
-            used_memory += processes[i].size;
-            allocated_processes++;
-        }
-    }
-
-    if (allocated_processes == 0) {
-        min_size = 0;
-        max_size = 0;
-    }
-
-    float avg_size = allocated_processes > 0 ? (float)total_size / allocated_processes : 0;
-
-    printf("\nMemory Statistics:\n");
-    printf("-- Average Process Size: %.2f KB\n", avg_size);
-    printf("-- Min Process Size: %d KB\n", min_size);
-    printf("-- Max Process Size: %d KB\n", max_size);
-    printf("-- Total RAM Available: %d KB\n", MEMORY_SIZE);
-    printf("-- Used Memory: %d KB\n", used_memory);
-    printf("-- Free Memory: %d KB\n", MEMORY_SIZE - used_memory);
-}
-
-void tick(int *num_processes) {
-    // Decrease execution time for processes inside memory
-    for (int i = 0; i < *num_processes; i++) {
-        if (processes[i].allocated && processes[i].remaining_time > 0) {
-            processes[i].remaining_time--;
-            if (processes[i].remaining_time == 0) {
-                printf("⚡ Process %d finished execution!\n", processes[i].id);
-                deallocate_memory(processes[i].id, *num_processes);
-                total_used_memory -= processes[i].size;
-                display_process_table(*num_processes);
-            }
-        }
-    }
-
-    // Try to allocate processes from waiting queue
-    for (int i = 0; i < waiting_count; i++) {
-        if (waiting_queue[i].size <= (MEMORY_SIZE - total_used_memory)) {
-            printf("Moving Process %d from waiting queue into memory!\n", waiting_queue[i].id);
-
-            // Move from waiting queue to processes array
-            processes[*num_processes] = waiting_queue[i];
-            allocate_memory(&processes[*num_processes], *num_processes);
-            total_used_memory += waiting_queue[i].size;
-            (*num_processes)++;
-
-            // Shift waiting queue left
-            for (int j = i; j < waiting_count - 1; j++) {
-                waiting_queue[j] = waiting_queue[j + 1];
-            }
-            waiting_count--;
-            i--; // adjust index
-        }
-    }
-}
-
-
-void display_waiting_queue() {
-    printf("\nWaiting Queue:\n");
-    printf("+------------+----------+--------------+--------------+--------------+\n");
-    printf("| Process ID |  Size KB | Arrival Time  | Exec Time(s) | Remaining(s)  |\n");
-    printf("+------------+----------+--------------+--------------+--------------+\n");
-
-    for (int i = 0; i < waiting_count; i++) {
-        printf("| %10d | %8d | %12d | %12d | %12d |\n",
-               waiting_queue[i].id,
-               waiting_queue[i].size,
-               waiting_queue[i].arrival_time,
-               waiting_queue[i].execution_time,
-               waiting_queue[i].remaining_time);
-    }
-
-    printf("+------------+----------+--------------+--------------+--------------+\n");
-}
-void* clock_tick_thread(void* arg) {
-    int *num_processes = (int *)arg;
-    int clock_counter = 0;
-
-    while (1) {
-        sleep(1); // wait 1 second
-        tick(num_processes);
-        clock_counter++;
-        // printf("\n🕰️  [Clock Tick %d Completed]\n", clock_counter);
-    }
-    return NULL;
-}
-
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h> // for sleep()
+
+#define MEMORY_SIZE 1024
+#define MAX_PROCESSES 20
+#define REQUEST_RING_SIZE 4096      // Must be a power of two
+#define REQUEST_BATCH 64            // Requests applied per arena lock hold
+#define BENCH_REQUESTS 200000       // Default requests per producer in bench mode
+#define BENCH_WINDOW 16             // Blocks each bench producer keeps live
+#define BENCH_MAX_PRODUCERS 8
+#define MAX_ARENAS 8
+#define CACHE_MAX_SIZE 64           // Largest block (KB) kept in a thread cache
+#define CACHE_DEPTH 8               // Blocks kept per size class
+#define CACHE_FLUSH_INTERVAL 4096   // Cache operations between flushes
+
+typedef struct {
+    int id;
+    int size;
+    int allocated;
+    int start_address;
+    int arrival_time;
+    int execution_time;
+    int remaining_time;
+} Process;
+
+typedef struct FreeBlock {
+    int start;
+    int size;
+    struct FreeBlock *next;
+} FreeBlock;
+
+// A range of memory with its own free list and lock. Every block operation
+// goes through an arena so the clock thread and the menu (or any number of
+// producer threads) can allocate and free at the same time.
+typedef struct {
+    FreeBlock *free_list;   // Sorted by start address
+    int base;
+    int size;
+    int used;
+    pthread_mutex_t lock;
+} Arena;
+
+typedef enum {
+    REQUEST_ALLOC,      // Allocate size, record the block in the handle
+    REQUEST_FREE,       // Free the block recorded in the handle
+    REQUEST_PROCESS,    // submit_process() with the process fields; the
+                        // handle, if any, receives the block it was given
+    REQUEST_TICK        // Run one clock tick
+} RequestType;
+
+// A block owned by a client of the request ring. Only the allocator thread
+// reads or writes it, and a client's requests are applied in the order it
+// sent them, so a free always sees the block stored by its allocation.
+typedef struct {
+    int start;
+    int size;
+} BlockHandle;
+
+typedef struct {
+    RequestType type;
+    BlockHandle *handle;
+    int id, size, arrival_time, execution_time;
+    int *result;            // Where to store the outcome, may be NULL
+    atomic_int *done;       // Set to 1 once applied, may be NULL
+} Request;
+
+// Bounded multi-producer single-consumer ring (Vyukov). Each cell's sequence
+// tells producers and the consumer whose turn it is, so neither side locks.
+typedef struct {
+    atomic_size_t sequence;
+    Request request;
+} RequestCell;
+
+typedef struct {
+    RequestCell cells[REQUEST_RING_SIZE];
+    _Alignas(64) atomic_size_t enqueue_pos;
+    _Alignas(64) size_t dequeue_pos;    // Only the allocator thread uses this
+    atomic_size_t applied;              // Requests applied so far
+    atomic_bool running;
+} RequestRing;
+
+// Blocks a thread freed recently, one stack per exact size, reused by the
+// same thread without touching the arena. The blocks stay counted as used
+// in the arena until they are flushed back.
+typedef struct {
+    int starts[CACHE_MAX_SIZE][CACHE_DEPTH];
+    int counts[CACHE_MAX_SIZE];
+    int operations;         // Since the last flush
+    long hits;
+    long misses;
+} ThreadCache;
+
+// Global Variables
+// Lock order: table_lock, then queue_lock, then arena locks in index order.
+// The process table and waiting queue functions expect the caller to hold
+// their lock; the arena functions take the arena lock themselves.
+Process processes[MAX_PROCESSES];
+int num_processes = 0;
+pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+Process waiting_queue[MAX_PROCESSES];
+int waiting_count = 0;
+pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+Arena arenas[MAX_ARENAS];          // MEMORY_SIZE split into arena_count ranges
+int arena_count = 0;
+atomic_int next_thread_arena = 0;
+static __thread int thread_home_arena = -1;
+RequestRing requests;
+static __thread ThreadCache thread_cache;
+atomic_long cache_hits = 0;
+atomic_long cache_misses = 0;
+atomic_long cache_flushes = 0;
+
+void initialize_memory(int count);
+int arena_alloc(Arena *a, int size);
+int arena_alloc_locked(Arena *a, int size);
+void arena_free(Arena *a, int start, int size);
+void arena_free_locked(Arena *a, int start, int size);
+int arena_used(Arena *a);
+Arena* arena_of(int start);
+int pid_arena(int id);
+int thread_arena();
+int pool_alloc(int home, int size);
+int pool_alloc_locked(int home, int size);
+void pool_free(int start, int size);
+int pool_used();
+int largest_arena();
+void lock_all_arenas();
+void unlock_all_arenas();
+int cache_alloc(int size);
+void cache_free(int start, int size);
+void cache_flush();
+int submit_process(int id, int size, int arrival_time, int execution_time, int *start_address);
+int allocate_memory(Process *p, int num_processes);
+void deallocate_memory(int process_id, int num_processes);
+void display_memory_state();
+void display_process_table(int num_processes);
+void save_memory_state();
+void merge_free_blocks(Arena *a);
+void calculate_process_stats(int num_processes);
+void tick(int *num_processes);
+void display_waiting_queue();
+void* clock_tick_thread();
+void request_ring_init(RequestRing *ring);
+int request_enqueue(RequestRing *ring, const Request *request);
+void request_submit(RequestRing *ring, const Request *request);
+int request_dequeue(RequestRing *ring, Request *request);
+void apply_request_batch(Request *batch, int count);
+void* allocator_thread(void *arg);
+void run_benchmark(int requests_per_producer);
+int process_entry_number = 1;
+
+
+
+int main(int argc, char *argv[]) {
+    initialize_memory(argc > 2 && strcmp(argv[1], "arenas") == 0 ? atoi(argv[2]) : 1);
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        run_benchmark(argc > 2 ? atoi(argv[2]) : BENCH_REQUESTS);
+        return 0;
+    }
+
+    int choice;
+    // int clock_tick_counter = 0;
+    pthread_t tid, allocator_tid;
+    request_ring_init(&requests);
+    pthread_create(&allocator_tid, NULL, allocator_thread, &requests);
+    pthread_create(&tid, NULL, clock_tick_thread, (void *)&num_processes);
+
+    printf("\n--- Welcome to Dynamic Partitioning Memory Manager ---\n");
+
+    while (1) {
+        // printf("\n==============================\n");
+        // printf("🕰️  Clock Tick: %d\n", clock_tick_counter);
+        // printf("==============================\n");
+        printf("\nChoose an option:\n");
+        printf("1. Add New Process\n");
+        printf("2. Show Process Table\n");
+        printf("3. Show Waiting Queue\n");
+        printf("4. Show Memory Statistics\n");
+        printf("5. Exit\n");
+        printf("Enter your choice: ");
+        scanf("%d", &choice);
+
+        // sleep(1);  // simulate time passing
+        // tick(&num_processes);
+        // clock_tick_counter++;
+
+        switch (choice) {
+            case 1: {
+                if (pool_used() < MEMORY_SIZE) {
+                    printf("\nEnter process ID, memory size (KB), arrival time, and execution time for process %d (or enter -1 to cancel): ", process_entry_number);
+                    int id, size, arrival_time, execution_time;
+                    scanf("%d", &id);
+                    if (id == -1) break;
+                    scanf("%d %d %d", &size, &arrival_time, &execution_time);
+
+                    int result;
+                    atomic_int done = 0;
+                    BlockHandle placed = { -1, size };
+                    Request request = { REQUEST_PROCESS, &placed, id, size, arrival_time, execution_time, &result, &done };
+                    request_submit(&requests, &request);
+                    while (!atomic_load_explicit(&done, memory_order_acquire)) {
+                        usleep(100);
+                    }
+                    if (result == 0) {
+                        printf("Memory full! Process %d is added to waiting queue.\n", id);
+                    } else if (result == -2) {
+                        printf("Process %d needs %d KB but no arena is larger than %d KB! Process rejected.\n",
+                               id, size, largest_arena());
+                        break;
+                    } else if (result < 0) {
+                        printf("Process table and waiting queue are full! Process %d rejected.\n", id);
+                        break;
+                    } else {
+                        pthread_mutex_lock(&table_lock);
+                        printf("Process %d allocated at Address: %d KB\n", id, placed.start);
+                        display_memory_state();
+                        save_memory_state();
+                        display_process_table(num_processes);
+                        calculate_process_stats(num_processes);
+                        pthread_mutex_unlock(&table_lock);
+                    }
+                    process_entry_number++;
+                } else {
+                    printf("Memory Full! Cannot add process right now.\n");
+                }
+                break;
+            }
+            case 2:
+                pthread_mutex_lock(&table_lock);
+                display_process_table(num_processes);
+                pthread_mutex_unlock(&table_lock);
+                break;
+            case 3:
+                pthread_mutex_lock(&queue_lock);
+                display_waiting_queue();
+                pthread_mutex_unlock(&queue_lock);
+                break;
+            case 4:
+                pthread_mutex_lock(&table_lock);
+                calculate_process_stats(num_processes);
+                pthread_mutex_unlock(&table_lock);
+                break;
+            case 5:
+                printf("\nExiting Memory Manager. Final memory state:\n");
+                pthread_mutex_lock(&table_lock);
+                display_memory_state();
+                display_process_table(num_processes);
+                exit(0);
+            default:
+                printf("Invalid choice. Please try again!\n");
+        }
+    }
+}
+
+
+// Functions
+
+// Split MEMORY_SIZE into `count` arenas, each one free block to start with.
+// Safe to call again between runs, but not while other threads use memory.
+void initialize_memory(int count) {
+    if (count < 1) count = 1;
+    if (count > MAX_ARENAS) count = MAX_ARENAS;
+
+    for (int i = 0; i < arena_count; i++) {
+        while (arenas[i].free_list) {
+            FreeBlock *next = arenas[i].free_list->next;
+            free(arenas[i].free_list);
+            arenas[i].free_list = next;
+        }
+        pthread_mutex_destroy(&arenas[i].lock);
+    }
+
+    arena_count = count;
+    for (int i = 0; i < count; i++) {
+        Arena *a = &arenas[i];
+        a->base = i * (MEMORY_SIZE / count);
+        a->size = (i == count - 1) ? MEMORY_SIZE - a->base : MEMORY_SIZE / count;
+        a->used = 0;
+        a->free_list = (FreeBlock *)malloc(sizeof(FreeBlock));
+        a->free_list->start = a->base;
+        a->free_list->size = a->size;
+        a->free_list->next = NULL;
+        pthread_mutex_init(&a->lock, NULL);
+    }
+}
+
+// Carve a best-fit block out of the arena. Returns its start, or -1.
+int arena_alloc(Arena *a, int size) {
+    pthread_mutex_lock(&a->lock);
+    int start = arena_alloc_locked(a, size);
+    pthread_mutex_unlock(&a->lock);
+    return start;
+}
+
+// Caller holds the arena lock
+int arena_alloc_locked(Arena *a, int size) {
+    FreeBlock *best_fit = NULL, *prev = NULL, *current = a->free_list, *best_prev = NULL;
+    int start;
+
+    while (current) {
+        if (current->size >= size) {
+            if (!best_fit || current->size < best_fit->size) {
+                best_fit = current;
+                best_prev = prev;
+            }
+        }
+        prev = current;
+        current = current->next;
+    }
+
+    if (!best_fit) {
+        return -1;
+    }
+
+    start = best_fit->start;
+    best_fit->start += size;
+    best_fit->size -= size;
+    a->used += size;
+
+    if (best_fit->size == 0) {
+        if (best_prev)
+            best_prev->next = best_fit->next;
+        else
+            a->free_list = best_fit->next;
+        free(best_fit);
+    }
+    return start;
+}
+
+// Give a block back to the arena, keeping the free list in address order
+// so neighbouring holes always end up next to each other and merge.
+void arena_free(Arena *a, int start, int size) {
+    pthread_mutex_lock(&a->lock);
+    arena_free_locked(a, start, size);
+    pthread_mutex_unlock(&a->lock);
+}
+
+// Caller holds the arena lock
+void arena_free_locked(Arena *a, int start, int size) {
+    FreeBlock *new_block = (FreeBlock *)malloc(sizeof(FreeBlock));
+    if (!new_block) {
+        printf("Memory allocation failed!\n");
+        exit(1);
+    }
+    new_block->start = start;
+    new_block->size = size;
+
+    FreeBlock **link = &a->free_list;
+    while (*link && (*link)->start < start) {
+        link = &(*link)->next;
+    }
+    new_block->next = *link;
+    *link = new_block;
+    a->used -= size;
+    merge_free_blocks(a);
+}
+
+int arena_used(Arena *a) {
+    pthread_mutex_lock(&a->lock);
+    int used = a->used;
+    pthread_mutex_unlock(&a->lock);
+    return used;
+}
+
+// The arena whose address range holds `start`
+Arena* arena_of(int start) {
+    int i = arena_count - 1;
+    while (i > 0 && start < arenas[i].base) i--;
+    return &arenas[i];
+}
+
+// Home arena of a process, so its allocations spread evenly over the arenas
+int pid_arena(int id) {
+    return (int)(((unsigned)id * 2654435761u) % (unsigned)arena_count);
+}
+
+// Home arena of the calling thread, handed out round robin on first use
+int thread_arena() {
+    if (thread_home_arena < 0) {
+        thread_home_arena = atomic_fetch_add(&next_thread_arena, 1);
+    }
+    return thread_home_arena % arena_count;
+}
+
+// Allocate from the home arena, falling back to the others in turn
+int pool_alloc(int home, int size) {
+    for (int i = 0; i < arena_count; i++) {
+        int start = arena_alloc(&arenas[(home + i) % arena_count], size);
+        if (start >= 0) return start;
+    }
+    return -1;
+}
+
+// Caller holds every arena lock
+int pool_alloc_locked(int home, int size) {
+    for (int i = 0; i < arena_count; i++) {
+        int start = arena_alloc_locked(&arenas[(home + i) % arena_count], size);
+        if (start >= 0) return start;
+    }
+    return -1;
+}
+
+void pool_free(int start, int size) {
+    arena_free(arena_of(start), start, size);
+}
+
+int pool_used() {
+    int used = 0;
+    for (int i = 0; i < arena_count; i++) {
+        used += arena_used(&arenas[i]);
+    }
+    return used;
+}
+
+// Size of the biggest arena: no single block can be larger
+int largest_arena() {
+    int largest = 0;
+    for (int i = 0; i < arena_count; i++) {
+        if (arenas[i].size > largest) largest = arenas[i].size;
+    }
+    return largest;
+}
+
+void lock_all_arenas() {
+    for (int i = 0; i < arena_count; i++) {
+        pthread_mutex_lock(&arenas[i].lock);
+    }
+}
+
+void unlock_all_arenas() {
+    for (int i = arena_count - 1; i >= 0; i--) {
+        pthread_mutex_unlock(&arenas[i].lock);
+    }
+}
+
+// Allocate from the calling thread's cache, falling back to the arena. If
+// the arena has no hole left, the cache is flushed so its blocks can merge
+// and the allocation is tried once more.
+int cache_alloc(int size) {
+    ThreadCache *cache = &thread_cache;
+
+    if (++cache->operations >= CACHE_FLUSH_INTERVAL) {
+        cache_flush();
+    }
+    if (size <= CACHE_MAX_SIZE && cache->counts[size - 1] > 0) {
+        cache->hits++;
+        return cache->starts[size - 1][--cache->counts[size - 1]];
+    }
+
+    cache->misses++;
+    int start = pool_alloc(thread_arena(), size);
+    if (start < 0) {
+        cache_flush();
+        start = pool_alloc(thread_arena(), size);
+    }
+    return start;
+}
+
+// Keep a freed block for this thread if its size class has room
+void cache_free(int start, int size) {
+    ThreadCache *cache = &thread_cache;
+
+    if (++cache->operations >= CACHE_FLUSH_INTERVAL) {
+        cache_flush();
+    }
+    if (size <= CACHE_MAX_SIZE && cache->counts[size - 1] < CACHE_DEPTH) {
+        cache->starts[size - 1][cache->counts[size - 1]++] = start;
+        return;
+    }
+    pool_free(start, size);
+}
+
+// Return every block in the calling thread's cache to its arena, one lock
+// hold per arena, so they can coalesce with their neighbours. Also
+// publishes the thread's hit counters.
+void cache_flush() {
+    ThreadCache *cache = &thread_cache;
+
+    for (int i = 0; i < arena_count; i++) {
+        Arena *a = &arenas[i];
+        pthread_mutex_lock(&a->lock);
+        for (int size = 1; size <= CACHE_MAX_SIZE; size++) {
+            for (int j = 0; j < cache->counts[size - 1]; j++) {
+                int start = cache->starts[size - 1][j];
+                if (arena_of(start) == a) {
+                    arena_free_locked(a, start, size);
+                }
+            }
+        }
+        pthread_mutex_unlock(&a->lock);
+    }
+    memset(cache->counts, 0, sizeof(cache->counts));
+
+    atomic_fetch_add(&cache_hits, cache->hits);
+    atomic_fetch_add(&cache_misses, cache->misses);
+    atomic_fetch_add(&cache_flushes, 1);
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->operations = 0;
+}
+
+// Thread-safe entry point for new processes. The block is carved out under
+// the arena lock alone; the table or queue lock is only held to record the
+// result. Returns 1 if allocated, storing the block in *start_address when
+// it is not NULL, 0 if queued, -1 if there was no room, and -2 if the
+// process is larger than any arena and so could never be allocated.
+int submit_process(int id, int size, int arrival_time, int execution_time, int *start_address) {
+    Process p = { id, size, 0, -1, arrival_time, execution_time, execution_time };
+
+    if (size > largest_arena()) {
+        return -2;
+    }
+
+    p.start_address = pool_alloc(pid_arena(id), size);
+    if (p.start_address >= 0) {
+        pthread_mutex_lock(&table_lock);
+        if (num_processes < MAX_PROCESSES) {
+            p.allocated = 1;
+            processes[num_processes++] = p;
+            pthread_mutex_unlock(&table_lock);
+            if (start_address) *start_address = p.start_address;
+            return 1;
+        }
+        pthread_mutex_unlock(&table_lock);
+        pool_free(p.start_address, size);
+        p.start_address = -1;
+    }
+
+    pthread_mutex_lock(&queue_lock);
+    if (waiting_count == MAX_PROCESSES) {
+        pthread_mutex_unlock(&queue_lock);
+        return -1;
+    }
+    waiting_queue[waiting_count++] = p;
+    pthread_mutex_unlock(&queue_lock);
+    return 0;
+}
+
+// Caller holds table_lock
+int allocate_memory(Process *p, int num_processes) {
+    int start = pool_alloc(pid_arena(p->id), p->size);
+
+    if (start < 0) {
+        printf("Process %d (Size: %d KB) cannot be allocated! Not enough memory.\n", p->id, p->size);
+        return 0;
+    }
+
+    p->start_address = start;
+    p->allocated = 1;
+
+    printf("Process %d allocated at Address: %d KB\n", p->id, p->start_address);
+    display_memory_state();
+    save_memory_state();
+    display_process_table(num_processes + 1);
+    return 1;
+}
+
+// Caller holds table_lock
+void deallocate_memory(int process_id, int num_processes) {
+    int found = 0, freed_size = 0, start_address = -1;
+
+    for (int i = 0; i < num_processes; i++) {
+        if (processes[i].id == process_id && processes[i].allocated) {
+            start_address = processes[i].start_address;
+            freed_size = processes[i].size;
+            processes[i].allocated = 0;
+            processes[i].start_address = -1;
+            found = 1;
+            break;
+        }
+    }
+
+    if (!found) {
+        printf("Process %d not found in memory.\n", process_id);
+        return;
+    }
+
+    pool_free(start_address, freed_size);
+
+    printf("Process %d deallocated, Freed %d KB\n", process_id, freed_size);
+    display_memory_state();
+    save_memory_state();
+}
+
+// Caller holds the arena lock
+void merge_free_blocks(Arena *a) {
+    FreeBlock *current = a->free_list, *next;
+    while (current && current->next) {
+        next = current->next;
+        if (current->start + current->size == next->start) {
+            current->size += next->size;
+            current->next = next->next;
+            free(next);
+        } else {
+            current = current->next;
+        }
+    }
+}
+
+void display_memory_state() {
+    printf("\nCurrent Memory State:\n");
+    for (int i = 0; i < arena_count; i++) {
+        pthread_mutex_lock(&arenas[i].lock);
+        if (arena_count > 1) {
+            printf("Arena %d (%d KB at %d KB): ", i, arenas[i].size, arenas[i].base);
+        }
+        FreeBlock *current = arenas[i].free_list;
+        while (current) {
+            printf("[ Free: %d KB at %d KB ] ", current->size, current->start);
+            current = current->next;
+        }
+        pthread_mutex_unlock(&arenas[i].lock);
+        printf("\n");
+    }
+}
+
+// Caller holds table_lock
+void display_process_table(int num_processes) {
+    printf("\nProcess Table:\n");
+    printf("+------------+----------+--------------+--------------+--------------+--------------+------------+\n");
+    printf("| Process ID |  Size KB | Start Address | Arrival Time | Exec Time(s) | Remaining(s) | Allocated  |\n");
+    printf("+------------+----------+--------------+--------------+--------------+--------------+------------+\n");
+
+    for (int i = 0; i < num_processes; i++) {
+        printf("| %10d | %8d | %12d | %12d | %12d | %12d | %10s |\n",
+               processes[i].id,
+               processes[i].size,
+               processes[i].start_address,
+               processes[i].arrival_time,
+               processes[i].execution_time,
+               processes[i].remaining_time,
+               processes[i].allocated ? "YES" : "NO");
+    }
+
+    printf("+------------+----------+--------------+--------------+--------------+--------------+------------+\n");
+}
+
+
+void save_memory_state() {
+    FILE *file = fopen("memory_state.txt", "w");
+    if (!file) {
+        printf("Error opening file!\n");
+        return;
+    }
+
+    fprintf(file, "Memory State:\n");
+    lock_all_arenas();
+    int free_blocks = 0;
+    for (int i = 0; i < arena_count; i++) {
+        FreeBlock *current = arenas[i].free_list;
+        while (current) {
+            fprintf(file, "[ Free: %d KB at %d KB ]\n", current->size, current->start);
+            current = current->next;
+            free_blocks++;
+        }
+    }
+    if (free_blocks == 0) {
+        fprintf(file, "No free memory available. All memory is allocated.\n");
+    }
+    unlock_all_arenas();
+
+    fclose(file);
+    printf("Memory state saved to 'memory_state.txt'\n");
+}
+
+// Caller holds table_lock
+void calculate_process_stats(int num_processes) {
+    if (num_processes == 0) return;
+
+    int total_size = 0, min_size = 999999, max_size = 0;
+    int used_memory = 0;
+    int allocated_processes = 0;
+
+    for (int i = 0; i < num_processes; i++) {
+        if (processes[i].allocated) {
+            total_size += processes[i].size;
+            if (processes[i].size < min_size) min_size = processes[i].size;
+            if (processes[i].size > max_size) max_size = processes[i].size;
+            used_memory += processes[i].size;
+            allocated_processes++;
+        }
+    }
+
+    if (allocated_processes == 0) {
+        min_size = 0;
+        max_size = 0;
+    }
+
+    float avg_size = allocated_processes > 0 ? (float)total_size / allocated_processes : 0;
+
+    printf("\nMemory Statistics:\n");
+    printf("-- Average Process Size: %.2f KB\n", avg_size);
+    printf("-- Min Process Size: %d KB\n", min_size);
+    printf("-- Max Process Size: %d KB\n", max_size);
+    printf("-- Total RAM Available: %d KB\n", MEMORY_SIZE);
+    printf("-- Used Memory: %d KB\n", used_memory);
+    printf("-- Free Memory: %d KB\n", MEMORY_SIZE - used_memory);
+}
+
+void tick(int *num_processes) {
+    pthread_mutex_lock(&table_lock);
+
+    // Decrease execution time for processes inside memory
+    for (int i = 0; i < *num_processes; i++) {
+        if (processes[i].allocated && processes[i].remaining_time > 0) {
+            processes[i].remaining_time--;
+            if (processes[i].remaining_time == 0) {
+                printf("⚡ Process %d finished execution!\n", processes[i].id);
+                deallocate_memory(processes[i].id, *num_processes);
+                display_process_table(*num_processes);
+            }
+        }
+    }
+
+    // Try to allocate processes from waiting queue
+    pthread_mutex_lock(&queue_lock);
+    for (int i = 0; i < waiting_count && *num_processes < MAX_PROCESSES; i++) {
+        if (waiting_queue[i].size <= MEMORY_SIZE - pool_used()) {
+            // Move from waiting queue to processes array
+            processes[*num_processes] = waiting_queue[i];
+            if (!allocate_memory(&processes[*num_processes], *num_processes)) {
+                continue; // Enough memory in total, but no hole is big enough
+            }
+            printf("Moved Process %d from waiting queue into memory!\n", waiting_queue[i].id);
+            (*num_processes)++;
+
+            // Shift waiting queue left
+            for (int j = i; j < waiting_count - 1; j++) {
+                waiting_queue[j] = waiting_queue[j + 1];
+            }
+            waiting_count--;
+            i--; // adjust index
+        }
+    }
+    pthread_mutex_unlock(&queue_lock);
+    pthread_mutex_unlock(&table_lock);
+}
+
+
+// Caller holds queue_lock
+void display_waiting_queue() {
+    printf("\nWaiting Queue:\n");
+    printf("+------------+----------+--------------+--------------+--------------+\n");
+    printf("| Process ID |  Size KB | Arrival Time  | Exec Time(s) | Remaining(s)  |\n");
+    printf("+------------+----------+--------------+--------------+--------------+\n");
+
+    for (int i = 0; i < waiting_count; i++) {
+        printf("| %10d | %8d | %12d | %12d | %12d |\n",
+               waiting_queue[i].id,
+               waiting_queue[i].size,
+               waiting_queue[i].arrival_time,
+               waiting_queue[i].execution_time,
+               waiting_queue[i].remaining_time);
+    }
+
+    printf("+------------+----------+--------------+--------------+--------------+\n");
+}
+void* clock_tick_thread(void* arg) {
+    int *num_processes = (int *)arg;
+    int clock_counter = 0;
+
+    (void)num_processes; // The allocator thread owns the process table
+    Request request = { REQUEST_TICK, NULL, 0, 0, 0, 0, NULL, NULL };
+
+    while (1) {
+        sleep(1); // wait 1 second
+        request_submit(&requests, &request);
+        clock_counter++;
+        // printf("\n🕰️  [Clock Tick %d Completed]\n", clock_counter);
+    }
+    return NULL;
+}
+
+
+void request_ring_init(RequestRing *ring) {
+    for (size_t i = 0; i < REQUEST_RING_SIZE; i++) {
+        atomic_init(&ring->cells[i].sequence, i);
+    }
+    atomic_init(&ring->enqueue_pos, 0);
+    ring->dequeue_pos = 0;
+    atomic_init(&ring->applied, 0);
+    atomic_init(&ring->running, true);
+}
+
+// Claim the next cell and publish the request in it. Safe from any number of
+// threads. Returns 0 if the ring is full.
+int request_enqueue(RequestRing *ring, const Request *request) {
+    size_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    RequestCell *cell;
+
+    while (1) {
+        cell = &ring->cells[pos & (REQUEST_RING_SIZE - 1)];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->request = *request;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return 1;
+}
+
+// Enqueue, waiting for the allocator thread to make room if the ring is full
+void request_submit(RequestRing *ring, const Request *request) {
+    while (!request_enqueue(ring, request)) {
+        sched_yield();
+    }
+}
+
+// Take the oldest published request. Only the allocator thread calls this.
+int request_dequeue(RequestRing *ring, Request *request) {
+    RequestCell *cell = &ring->cells[ring->dequeue_pos & (REQUEST_RING_SIZE - 1)];
+    size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+
+    if (sequence != ring->dequeue_pos + 1) {
+        return 0;
+    }
+    *request = cell->request;
+    atomic_store_explicit(&cell->sequence, ring->dequeue_pos + REQUEST_RING_SIZE, memory_order_release);
+    ring->dequeue_pos++;
+    return 1;
+}
+
+// Apply a batch in order. Runs of block requests share one lock hold. For
+// block requests, `id` carries the home arena of the client.
+void apply_request_batch(Request *batch, int count) {
+    int i = 0;
+
+    while (i < count) {
+        if (batch[i].type == REQUEST_ALLOC || batch[i].type == REQUEST_FREE) {
+            lock_all_arenas();
+            for (; i < count && (batch[i].type == REQUEST_ALLOC || batch[i].type == REQUEST_FREE); i++) {
+                BlockHandle *handle = batch[i].handle;
+                if (batch[i].type == REQUEST_ALLOC) {
+                    handle->start = pool_alloc_locked(batch[i].id, batch[i].size);
+                    handle->size = batch[i].size;
+                } else if (handle->start >= 0) {
+                    arena_free_locked(arena_of(handle->start), handle->start, handle->size);
+                    handle->start = -1;
+                }
+            }
+            unlock_all_arenas();
+            continue;
+        }
+
+        int result = 0;
+        if (batch[i].type == REQUEST_PROCESS) {
+            result = submit_process(batch[i].id, batch[i].size, batch[i].arrival_time, batch[i].execution_time,
+                                    batch[i].handle ? &batch[i].handle->start : NULL);
+        } else {
+            tick(&num_processes);
+        }
+        if (batch[i].result) *batch[i].result = result;
+        if (batch[i].done) atomic_store_explicit(batch[i].done, 1, memory_order_release);
+        i++;
+    }
+}
+
+// The single consumer of the request ring: the only thread that changes the
+// block structure, the process table or the waiting queue.
+void* allocator_thread(void *arg) {
+    RequestRing *ring = (RequestRing *)arg;
+    Request batch[REQUEST_BATCH];
+    int idle = 0;
+
+    while (atomic_load_explicit(&ring->running, memory_order_relaxed) || idle == 0) {
+        int count = 0;
+        while (count < REQUEST_BATCH && request_dequeue(ring, &batch[count])) {
+            count++;
+        }
+        if (count == 0) {
+            // Spin briefly for the next burst, then back off
+            if (++idle < 1000) sched_yield();
+            else usleep(100);
+            continue;
+        }
+        idle = 0;
+        apply_request_batch(batch, count);
+        atomic_fetch_add_explicit(&ring->applied, count, memory_order_release);
+    }
+    return NULL;
+}
+
+typedef enum {
+    BENCH_DIRECT,           // Every producer takes the arena lock
+    BENCH_RING,             // Producers feed the allocator thread
+    BENCH_CACHE,            // Producers go through their thread cache first
+    BENCH_MODES
+} BenchMode;
+
+typedef struct {
+    BenchMode mode;
+    int requests;
+    unsigned seed;
+    long failures;          // Allocations no arena could satisfy (not counted for the ring)
+} BenchProducer;
+
+static double elapsed_seconds(struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Allocate BENCH_WINDOW blocks, free them, repeat
+static void* bench_producer(void *arg) {
+    BenchProducer *producer = (BenchProducer *)arg;
+    BlockHandle handles[BENCH_WINDOW];
+    int sent = 0;
+
+    while (sent < producer->requests) {
+        for (int k = 0; k < BENCH_WINDOW; k++) {
+            int size = 1 + rand_r(&producer->seed) % 16;
+            if (producer->mode == BENCH_DIRECT) {
+                handles[k].size = size;
+                handles[k].start = pool_alloc(thread_arena(), size);
+                if (handles[k].start < 0) producer->failures++;
+            } else if (producer->mode == BENCH_CACHE) {
+                handles[k].size = size;
+                handles[k].start = cache_alloc(size);
+                if (handles[k].start < 0) producer->failures++;
+            } else {
+                Request request = { REQUEST_ALLOC, &handles[k], thread_arena(), size, 0, 0, NULL, NULL };
+                request_submit(&requests, &request);
+            }
+        }
+        for (int k = 0; k < BENCH_WINDOW; k++) {
+            if (producer->mode == BENCH_DIRECT) {
+                if (handles[k].start >= 0) pool_free(handles[k].start, handles[k].size);
+            } else if (producer->mode == BENCH_CACHE) {
+                if (handles[k].start >= 0) cache_free(handles[k].start, handles[k].size);
+            } else {
+                Request request = { REQUEST_FREE, &handles[k], 0, 0, 0, 0, NULL, NULL };
+                request_submit(&requests, &request);
+            }
+        }
+        sent += 2 * BENCH_WINDOW;
+    }
+
+    if (producer->mode == BENCH_CACHE) {
+        cache_flush();
+    }
+
+    // The allocator thread may still hold requests that point at our handles
+    if (producer->mode == BENCH_RING) {
+        while (atomic_load_explicit(&requests.applied, memory_order_acquire) <
+               atomic_load_explicit(&requests.enqueue_pos, memory_order_relaxed)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// Run `producers` bench producers in one mode. Returns requests per second
+// and adds the allocations that failed to *failures.
+static double bench_run(BenchMode mode, int producers, int requests_per_producer, long *failures) {
+    pthread_t threads[BENCH_MAX_PRODUCERS], allocator_tid;
+    BenchProducer state[BENCH_MAX_PRODUCERS];
+    struct timespec start;
+
+    if (mode == BENCH_RING) {
+        request_ring_init(&requests);
+        pthread_create(&allocator_tid, NULL, allocator_thread, &requests);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < producers; i++) {
+        state[i] = (BenchProducer){ mode, requests_per_producer, (unsigned)(i + 1), 0 };
+        pthread_create(&threads[i], NULL, bench_producer, &state[i]);
+    }
+    for (int i = 0; i < producers; i++) {
+        pthread_join(threads[i], NULL);
+        *failures += state[i].failures;
+    }
+    double seconds = elapsed_seconds(&start);
+    if (mode == BENCH_RING) {
+        atomic_store(&requests.running, false);
+        pthread_join(allocator_tid, NULL);
+    }
+    return (double)producers * requests_per_producer / seconds;
+}
+
+// Measure allocate/free requests per second against the number of producer
+// threads: with every producer taking the arena lock, with all of them
+// feeding the allocator thread through the request ring, and with each
+// producer going through its own thread cache. Then, at the highest
+// producer count, split memory into more and more arenas to show how less
+// lock contention is paid for with allocations that fail because the free
+// memory is stranded in other arenas.
+void run_benchmark(int requests_per_producer) {
+    long failures = 0;
+
+    printf("\n--- Allocator Request Throughput (%d requests per producer, %d arena%s) ---\n",
+           requests_per_producer, arena_count, arena_count == 1 ? "" : "s");
+    printf("+-----------+----------------------+----------------------+----------------------+----------+\n");
+    printf("| Producers | Direct lock (req/s)  | Request ring (req/s) | Thread cache (req/s) | Hit rate |\n");
+    printf("+-----------+----------------------+----------------------+----------------------+----------+\n");
+
+    for (int producers = 1; producers <= BENCH_MAX_PRODUCERS; producers *= 2) {
+        double rate[BENCH_MODES];
+
+        atomic_store(&cache_hits, 0);
+        atomic_store(&cache_misses, 0);
+        for (BenchMode mode = 0; mode < BENCH_MODES; mode++) {
+            rate[mode] = bench_run(mode, producers, requests_per_producer, &failures);
+        }
+        long hits = atomic_load(&cache_hits), misses = atomic_load(&cache_misses);
+        printf("| %9d | %20.0f | %20.0f | %20.0f | %7.1f%% |\n", producers,
+               rate[BENCH_DIRECT], rate[BENCH_RING], rate[BENCH_CACHE],
+               hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0);
+    }
+    printf("+-----------+----------------------+----------------------+----------------------+----------+\n");
+    printf("Thread cache flushes: %ld\n", atomic_load(&cache_flushes));
+
+    printf("\n--- Arena Scaling (%d producers) ---\n", BENCH_MAX_PRODUCERS);
+    printf("+--------+----------------------+----------------------+----------------+\n");
+    printf("| Arenas | Direct lock (req/s)  | Thread cache (req/s) | Failed allocs  |\n");
+    printf("+--------+----------------------+----------------------+----------------+\n");
+    for (int count = 1; count <= MAX_ARENAS; count *= 2) {
+        long direct_failures = 0, cache_failures = 0;
+
+        initialize_memory(count);
+        double direct = bench_run(BENCH_DIRECT, BENCH_MAX_PRODUCERS, requests_per_producer, &direct_failures);
+        double cached = bench_run(BENCH_CACHE, BENCH_MAX_PRODUCERS, requests_per_producer, &cache_failures);
+        printf("| %6d | %20.0f | %20.0f | %13.2f%% |\n", count, direct, cached,
+               100.0 * (direct_failures + cache_failures) / (BENCH_MAX_PRODUCERS * (double)requests_per_producer));
+    }
+    printf("+--------+----------------------+----------------------+----------------+\n");
+    printf("Memory in use after the run: %d KB\n", pool_used());
+}
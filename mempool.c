@@ -0,0 +1,842 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "mempool.h"
+
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE 14
+#endif
+#ifndef MADV_FREE
+#define MADV_FREE 8
+#endif
+#define MPOL_BIND 2
+#define MAX_NUMA_NODES 1024
+#define DEFAULT_HUGE_PAGE_SIZE (2u << 20)
+
+#define NO_BLOCK 0                   // Descriptor index 0 is never used
+#define RADIX_LEAF_BITS 12           // Granules mapped by one radix leaf: 4096
+#define RADIX_LEAF_SIZE (1u << RADIX_LEAF_BITS)
+#define MAX_POOL_GRANULES UINT32_MAX
+#define FREE_MAP_LEVELS 6            // 64^6 bits cover every granule of the largest pool
+#define NO_GRANULE UINT32_MAX
+
+// Descriptor for one block of the region, free or allocated. Descriptors
+// form an address-ordered doubly linked list covering the whole region,
+// and free blocks are also on an address-ordered free list of their own so
+// placement never walks allocated blocks. Offsets and sizes are in
+// granules and links are descriptor indices, so a descriptor is 32 bytes
+// and the table stays densely packed.
+typedef struct PoolBlock {
+    uint32_t offset;
+    uint32_t size;
+    uint32_t prev;
+    uint32_t next;          // Also links unused descriptors together
+    uint32_t free_prev;     // Free list links, valid while is_free
+    uint32_t free_next;
+    uint32_t freed_pass;    // Scavenger pass count when the block was freed
+    uint8_t is_free;
+    uint8_t released;       // Interior pages already returned to the OS
+} PoolBlock;
+
+// All metadata lives in mappings of its own, never in the managed region
+// and never on the libc heap:
+//   blocks   - the descriptor table, reserved for the worst case of one
+//              block per granule and committed by the kernel as it is used
+//   radix    - a two-level radix tree from granule index to the descriptor
+//              of the block starting there; leaves are mapped on first use
+//   free_map - a bitmap of the granules where free blocks start, with a
+//              summary level above it for every 64 words, so the nearest
+//              free block below an address is found in a few word scans
+struct MemPool {
+    char* base;
+    size_t size;
+    uint32_t granules;
+    unsigned granule_shift;     // Granule is 1 << granule_shift bytes
+    size_t page_size;           // Page size backing the region
+    MemPoolPages pages;         // Page mode actually in use
+    int numa_node;
+    MemPoolFit fit;
+    pthread_mutex_t lock;
+
+    PoolBlock* blocks;
+    size_t blocks_bytes;
+    uint32_t block_top;         // Next never-used descriptor
+    uint32_t unused_blocks;     // Stack of unused descriptors
+    uint32_t head;
+    uint32_t free_head;         // Lowest-addressed free block
+
+    uint32_t** radix;
+    size_t radix_bytes;
+    uint32_t radix_leaves;
+
+    uint64_t* free_map[FREE_MAP_LEVELS];    // Level 0 has one bit per granule
+    int free_map_levels;
+    size_t free_map_bytes;                  // One mapping holding every level
+
+    size_t used;
+    int block_count;
+    int free_count;
+    long allocations;
+    long frees;
+    long failed_allocations;
+
+    MemPoolScavengeOptions scavenge;
+    pthread_t scavenger;
+    bool scavenger_running;
+    pthread_cond_t scavenger_wakeup;
+    uint32_t scavenge_passes;
+    size_t released_bytes;      // Returned to the OS over the pool's life
+};
+
+static size_t round_up(size_t value, size_t unit) {
+    return (value + unit - 1) / unit * unit;
+}
+
+static void* map_metadata(size_t bytes) {
+    void* memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return memory == MAP_FAILED ? NULL : memory;
+}
+
+// Take a descriptor from the table. Caller holds the lock.
+static uint32_t new_block(MemPool* pool, uint32_t offset, uint32_t size, bool is_free) {
+    uint32_t index = pool->unused_blocks;
+    if (index != NO_BLOCK) {
+        pool->unused_blocks = pool->blocks[index].next;
+    } else {
+        index = pool->block_top++;
+    }
+
+    PoolBlock* block = &pool->blocks[index];
+    block->offset = offset;
+    block->size = size;
+    block->is_free = is_free;
+    block->released = false;
+    block->freed_pass = pool->scavenge_passes;
+    block->prev = NO_BLOCK;
+    block->next = NO_BLOCK;
+    block->free_prev = NO_BLOCK;
+    block->free_next = NO_BLOCK;
+    pool->block_count++;
+    return index;
+}
+
+static uint32_t radix_get(const MemPool* pool, uint32_t granule);
+
+// Mark or clear the free block starting at `granule` in every level of the
+// free map. A summary bit only changes when its word becomes empty or stops
+// being empty, so most updates touch one word.
+static void free_map_set(MemPool* pool, uint32_t granule) {
+    uint64_t position = granule;
+    for (int level = 0; level < pool->free_map_levels; level++) {
+        uint64_t* word = &pool->free_map[level][position >> 6];
+        bool was_empty = *word == 0;
+        *word |= (uint64_t)1 << (position & 63);
+        if (!was_empty) {
+            break;
+        }
+        position >>= 6;
+    }
+}
+
+static void free_map_clear(MemPool* pool, uint32_t granule) {
+    uint64_t position = granule;
+    for (int level = 0; level < pool->free_map_levels; level++) {
+        uint64_t* word = &pool->free_map[level][position >> 6];
+        *word &= ~((uint64_t)1 << (position & 63));
+        if (*word != 0) {
+            break;
+        }
+        position >>= 6;
+    }
+}
+
+// Start of the highest-addressed free block below `granule`, or NO_GRANULE.
+// Climbs until a word has a set bit below the current position, then
+// descends taking the highest set bit at each level.
+static uint32_t free_map_prev(const MemPool* pool, uint32_t granule) {
+    uint64_t position = granule;
+    int level = 0;
+
+    while (level < pool->free_map_levels) {
+        uint64_t below = pool->free_map[level][position >> 6] & (((uint64_t)1 << (position & 63)) - 1);
+        if (below != 0) {
+            position = (position & ~(uint64_t)63) | (uint64_t)(63 - __builtin_clzll(below));
+            break;
+        }
+        position >>= 6;
+        level++;
+    }
+    if (level == pool->free_map_levels) {
+        return NO_GRANULE;
+    }
+    while (level-- > 0) {
+        position = (position << 6) | (uint64_t)(63 - __builtin_clzll(pool->free_map[level][position]));
+    }
+    return (uint32_t)position;
+}
+
+// Put a free block on the free list after `before` (NO_BLOCK for the head)
+static void free_list_link(MemPool* pool, uint32_t index, uint32_t before) {
+    PoolBlock* blocks = pool->blocks;
+    uint32_t after = before != NO_BLOCK ? blocks[before].free_next : pool->free_head;
+
+    blocks[index].free_prev = before;
+    blocks[index].free_next = after;
+    if (before != NO_BLOCK) {
+        blocks[before].free_next = index;
+    } else {
+        pool->free_head = index;
+    }
+    if (after != NO_BLOCK) {
+        blocks[after].free_prev = index;
+    }
+    free_map_set(pool, blocks[index].offset);
+}
+
+static void free_list_unlink(MemPool* pool, uint32_t index) {
+    PoolBlock* blocks = pool->blocks;
+
+    if (blocks[index].free_prev != NO_BLOCK) {
+        blocks[blocks[index].free_prev].free_next = blocks[index].free_next;
+    } else {
+        pool->free_head = blocks[index].free_next;
+    }
+    if (blocks[index].free_next != NO_BLOCK) {
+        blocks[blocks[index].free_next].free_prev = blocks[index].free_prev;
+    }
+    free_map_clear(pool, blocks[index].offset);
+}
+
+// Put a newly freed block on the free list in address order, after the
+// nearest free block below it as found in the free map
+static void free_list_insert(MemPool* pool, uint32_t index) {
+    uint32_t before = free_map_prev(pool, pool->blocks[index].offset);
+    free_list_link(pool, index, before != NO_GRANULE ? radix_get(pool, before) : NO_BLOCK);
+}
+
+static void release_block(MemPool* pool, uint32_t index) {
+    pool->blocks[index].next = pool->unused_blocks;
+    pool->unused_blocks = index;
+    pool->block_count--;
+}
+
+// Point the radix entry for `granule` at a descriptor (NO_BLOCK to clear).
+// Returns false if a leaf could not be mapped. Caller holds the lock.
+static bool radix_set(MemPool* pool, uint32_t granule, uint32_t index) {
+    uint32_t** leaf = &pool->radix[granule >> RADIX_LEAF_BITS];
+    if (*leaf == NULL) {
+        if (index == NO_BLOCK) {
+            return true;
+        }
+        *leaf = (uint32_t*)map_metadata(RADIX_LEAF_SIZE * sizeof(uint32_t));
+        if (*leaf == NULL) {
+            return false;
+        }
+        pool->radix_leaves++;
+    }
+    (*leaf)[granule & (RADIX_LEAF_SIZE - 1)] = index;
+    return true;
+}
+
+// Descriptor of the block starting at `granule`, or NO_BLOCK
+static uint32_t radix_get(const MemPool* pool, uint32_t granule) {
+    const uint32_t* leaf = pool->radix[granule >> RADIX_LEAF_BITS];
+    return leaf != NULL ? leaf[granule & (RADIX_LEAF_SIZE - 1)] : NO_BLOCK;
+}
+
+// Huge page size from /proc/meminfo, or 2 MB if it cannot be read. Uses
+// read() rather than stdio, which could allocate from the heap.
+static size_t huge_page_size() {
+    char text[4096];
+    size_t kb = 0;
+    int fd = open("/proc/meminfo", O_RDONLY);
+
+    if (fd < 0) {
+        return DEFAULT_HUGE_PAGE_SIZE;
+    }
+    ssize_t length = read(fd, text, sizeof(text) - 1);
+    close(fd);
+    if (length > 0) {
+        text[length] = '\0';
+        char* field = strstr(text, "Hugepagesize:");
+        if (field != NULL) {
+            kb = strtoul(field + strlen("Hugepagesize:"), NULL, 10);
+        }
+    }
+    return kb > 0 ? kb << 10 : DEFAULT_HUGE_PAGE_SIZE;
+}
+
+// Map `size` bytes aligned to `alignment` by over-mapping and trimming
+static char* map_aligned(size_t size, size_t alignment) {
+    char* raw = mmap(NULL, size + alignment, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED) {
+        return MAP_FAILED;
+    }
+    char* aligned = (char*)round_up((size_t)raw, alignment);
+    if (aligned > raw) {
+        munmap(raw, (size_t)(aligned - raw));
+    }
+    size_t tail = (size_t)(raw + size + alignment - (aligned + size));
+    if (tail > 0) {
+        munmap(aligned + size, tail);
+    }
+    return aligned;
+}
+
+// Map the managed region in the requested page mode. Reserved huge pages
+// often are not configured, so MEMPOOL_PAGES_HUGETLB falls back to
+// transparent huge pages; pool->pages records what was used.
+static bool map_region(MemPool* pool, size_t size, MemPoolPages pages) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    pool->base = MAP_FAILED;
+    if (pages == MEMPOOL_PAGES_HUGETLB) {
+        size_t huge = huge_page_size();
+        pool->size = round_up(size, huge);
+        pool->base = mmap(NULL, pool->size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        pool->page_size = huge;
+        pages = MEMPOOL_PAGES_TRANSPARENT;
+        pool->pages = MEMPOOL_PAGES_HUGETLB;
+    }
+    if (pool->base == MAP_FAILED && pages == MEMPOOL_PAGES_TRANSPARENT) {
+        size_t huge = huge_page_size();
+        pool->size = round_up(size, huge);
+        pool->base = map_aligned(pool->size, huge);
+        if (pool->base != MAP_FAILED && madvise(pool->base, pool->size, MADV_HUGEPAGE) != 0) {
+            munmap(pool->base, pool->size);
+            pool->base = MAP_FAILED;
+        }
+        pool->page_size = huge;
+        pool->pages = MEMPOOL_PAGES_TRANSPARENT;
+    }
+    if (pool->base == MAP_FAILED) {
+        pool->size = round_up(size, page);
+        pool->base = mmap(NULL, pool->size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        pool->page_size = page;
+        pool->pages = MEMPOOL_PAGES_DEFAULT;
+    }
+    return pool->base != MAP_FAILED;
+}
+
+// Bind the region to one NUMA node. Uses the raw system call so the pool
+// does not depend on libnuma.
+static bool bind_region(MemPool* pool, int node) {
+    unsigned long mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = { 0 };
+
+    if (node < 0 || node >= MAX_NUMA_NODES) {
+        errno = EINVAL;
+        return false;
+    }
+    mask[node / (8 * sizeof(unsigned long))] = 1ul << (node % (8 * sizeof(unsigned long)));
+    return syscall(SYS_mbind, pool->base, pool->size, MPOL_BIND, mask,
+                   (unsigned long)MAX_NUMA_NODES + 1, 0) == 0;
+}
+
+// Map a region of at least `size` bytes with default options
+MemPool* mempool_create(size_t size) {
+    return mempool_create_ex(size, NULL);
+}
+
+// Map a region of at least `size` bytes. A page-sized granule keeps every
+// block page aligned; with huge pages the region is also aligned to the
+// huge page size so the kernel can back it with them.
+MemPool* mempool_create_ex(size_t size, const MemPoolOptions* options) {
+    MemPoolOptions defaults = { MEMPOOL_PAGES_DEFAULT, -1, 0, MEMPOOL_FIT_BEST };
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if (options == NULL) {
+        options = &defaults;
+    }
+
+    size_t granule = options->granule == 0 ? MEMPOOL_GRANULE : options->granule;
+    if (size == 0 || granule < MEMPOOL_GRANULE || (granule & (granule - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    MemPool* pool = (MemPool*)map_metadata(round_up(sizeof(MemPool), page));
+    if (pool == NULL) {
+        return NULL;
+    }
+    while (((size_t)1 << pool->granule_shift) < granule) {
+        pool->granule_shift++;
+    }
+    pool->numa_node = options->numa_node;
+    pool->fit = options->fit;
+
+    if (!map_region(pool, size, options->pages) ||
+        (pool->size >> pool->granule_shift) > MAX_POOL_GRANULES - 1 ||
+        (options->numa_node >= 0 && !bind_region(pool, options->numa_node))) {
+        int error = errno;
+        if (pool->base != MAP_FAILED) munmap(pool->base, pool->size);
+        munmap(pool, round_up(sizeof(MemPool), page));
+        errno = error;
+        return NULL;
+    }
+    pool->granules = (uint32_t)(pool->size >> pool->granule_shift);
+    pool->blocks_bytes = round_up(((size_t)pool->granules + 1) * sizeof(PoolBlock), page);
+    pool->blocks = (PoolBlock*)map_metadata(pool->blocks_bytes);
+    pool->radix_bytes = round_up(((pool->granules >> RADIX_LEAF_BITS) + 1) * sizeof(uint32_t*), page);
+    pool->radix = (uint32_t**)map_metadata(pool->radix_bytes);
+
+    // Each free map level has a bit for every word of the level below,
+    // up to a single word
+    size_t level_words[FREE_MAP_LEVELS], map_words = 0, bits = pool->granules;
+    do {
+        level_words[pool->free_map_levels] = (bits + 63) / 64;
+        map_words += level_words[pool->free_map_levels];
+        bits = level_words[pool->free_map_levels++];
+    } while (bits > 1);
+    pool->free_map_bytes = round_up(map_words * sizeof(uint64_t), page);
+    pool->free_map[0] = (uint64_t*)map_metadata(pool->free_map_bytes);
+
+    if (pool->blocks == NULL || pool->radix == NULL || pool->free_map[0] == NULL) {
+        munmap(pool->base, pool->size);
+        if (pool->blocks != NULL) munmap(pool->blocks, pool->blocks_bytes);
+        if (pool->radix != NULL) munmap(pool->radix, pool->radix_bytes);
+        if (pool->free_map[0] != NULL) munmap(pool->free_map[0], pool->free_map_bytes);
+        munmap(pool, round_up(sizeof(MemPool), page));
+        return NULL;
+    }
+    for (int level = 1; level < pool->free_map_levels; level++) {
+        pool->free_map[level] = pool->free_map[level - 1] + level_words[level - 1];
+    }
+
+    // mempool_destroy expects the lock and condition variable, so set them
+    // up before the first failure path that uses it
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->scavenger_wakeup, NULL);
+    pool->block_top = NO_BLOCK + 1;
+    pool->head = new_block(pool, 0, pool->granules, true);
+    pool->blocks[pool->head].released = true;     // Never touched yet
+    pool->free_head = NO_BLOCK;
+    free_list_link(pool, pool->head, NO_BLOCK);
+    pool->free_count = 1;
+    if (!radix_set(pool, 0, pool->head)) {
+        mempool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void mempool_destroy(MemPool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+    mempool_stop_scavenger(pool);
+    for (uint32_t i = 0; i <= pool->granules >> RADIX_LEAF_BITS; i++) {
+        if (pool->radix[i] != NULL) {
+            munmap(pool->radix[i], RADIX_LEAF_SIZE * sizeof(uint32_t));
+        }
+    }
+    munmap(pool->radix, pool->radix_bytes);
+    munmap(pool->free_map[0], pool->free_map_bytes);
+    munmap(pool->blocks, pool->blocks_bytes);
+    munmap(pool->base, pool->size);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->scavenger_wakeup);
+    munmap(pool, round_up(sizeof(MemPool), (size_t)sysconf(_SC_PAGESIZE)));
+}
+
+static void absorb_next(MemPool* pool, uint32_t index);
+
+// Cut a free block after `at` granules. The second part becomes a new free
+// block, returned, or NO_BLOCK if no radix leaf could be mapped for it.
+// Caller holds the lock.
+static uint32_t split_block(MemPool* pool, uint32_t index, uint32_t at) {
+    PoolBlock* blocks = pool->blocks;
+    uint32_t rest = new_block(pool, blocks[index].offset + at, blocks[index].size - at, true);
+
+    if (!radix_set(pool, blocks[rest].offset, rest)) {
+        release_block(pool, rest);
+        return NO_BLOCK;
+    }
+    blocks[rest].released = blocks[index].released;
+    blocks[rest].freed_pass = blocks[index].freed_pass;
+    blocks[rest].prev = index;
+    blocks[rest].next = blocks[index].next;
+    if (blocks[index].next != NO_BLOCK) {
+        blocks[blocks[index].next].prev = rest;
+    }
+    blocks[index].next = rest;
+    blocks[index].size = at;
+    free_list_link(pool, rest, index);
+    pool->free_count++;
+    return rest;
+}
+
+// Granules to skip at the start of a block so the address is aligned. Kept
+// 64-bit: the pad is only known to fit a block once it is compared with one.
+static uint64_t alignment_pad(const MemPool* pool, const PoolBlock* block, size_t alignment) {
+    size_t start = (size_t)pool->base + ((size_t)block->offset << pool->granule_shift);
+    return (uint64_t)(round_up(start, alignment) - start) >> pool->granule_shift;
+}
+
+void* mempool_alloc(MemPool* pool, size_t size) {
+    return mempool_alloc_aligned(pool, MEMPOOL_GRANULE, size);
+}
+
+// Place a block with the pool's fit policy. An alignment above the granule
+// leaves a free pad block in front of the allocation.
+void* mempool_alloc_aligned(MemPool* pool, size_t alignment, size_t size) {
+    size_t granule = (size_t)1 << pool->granule_shift;
+    if (alignment < granule) {
+        alignment = granule;
+    }
+    if ((alignment & (alignment - 1)) != 0 || alignment > pool->size || size > pool->size) {
+        pthread_mutex_lock(&pool->lock);
+        pool->failed_allocations++;
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+    }
+    uint32_t needed = (uint32_t)(round_up(size == 0 ? 1 : size, granule) >> pool->granule_shift);
+    uint32_t best = NO_BLOCK;
+    uint64_t best_pad = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    PoolBlock* blocks = pool->blocks;
+    for (uint32_t current = pool->free_head; current != NO_BLOCK; current = blocks[current].free_next) {
+        uint64_t pad = alignment == granule ? 0 : alignment_pad(pool, &blocks[current], alignment);
+        if ((uint64_t)blocks[current].size < pad + needed) {
+            continue;
+        }
+        if (best == NO_BLOCK ||
+            (pool->fit == MEMPOOL_FIT_BEST && blocks[current].size < blocks[best].size) ||
+            (pool->fit == MEMPOOL_FIT_WORST && blocks[current].size > blocks[best].size)) {
+            best = current;
+            best_pad = pad;
+        }
+        if (pool->fit == MEMPOOL_FIT_FIRST ||
+            (pool->fit == MEMPOOL_FIT_BEST && blocks[best].size == needed + best_pad)) {
+            break;
+        }
+    }
+
+    if (best == NO_BLOCK) {
+        pool->failed_allocations++;
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+    }
+
+    uint32_t pad_block = NO_BLOCK;
+    if (best_pad > 0) {
+        pad_block = best;
+        best = split_block(pool, pad_block, (uint32_t)best_pad);
+    }
+    if (best != NO_BLOCK && blocks[best].size > needed && split_block(pool, best, needed) == NO_BLOCK) {
+        if (pad_block != NO_BLOCK) {
+            absorb_next(pool, pad_block);
+        }
+        best = NO_BLOCK;
+    }
+    if (best == NO_BLOCK) {
+        pool->failed_allocations++;
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+    }
+
+    blocks[best].is_free = false;
+    free_list_unlink(pool, best);
+    pool->free_count--;
+    pool->used += (size_t)needed << pool->granule_shift;
+    pool->allocations++;
+    void* ptr = pool->base + ((size_t)blocks[best].offset << pool->granule_shift);
+    pthread_mutex_unlock(&pool->lock);
+    return ptr;
+}
+
+// Allocated block starting at `ptr`, found through the radix tree in
+// constant time, or NO_BLOCK. Caller holds the lock.
+static uint32_t find_block(MemPool* pool, const void* ptr) {
+    if (!mempool_owns(pool, ptr)) {
+        return NO_BLOCK;
+    }
+    size_t offset = (size_t)((const char*)ptr - pool->base);
+    if ((offset & (((size_t)1 << pool->granule_shift) - 1)) != 0) {
+        return NO_BLOCK;
+    }
+    uint32_t index = radix_get(pool, (uint32_t)(offset >> pool->granule_shift));
+    return index != NO_BLOCK && !pool->blocks[index].is_free ? index : NO_BLOCK;
+}
+
+// Absorb the free block after `index` into it. Caller holds the lock.
+static void absorb_next(MemPool* pool, uint32_t index) {
+    PoolBlock* blocks = pool->blocks;
+    uint32_t next = blocks[index].next;
+
+    blocks[index].size += blocks[next].size;
+    blocks[index].released = false;     // The pages between them may be resident
+    if (blocks[next].freed_pass > blocks[index].freed_pass) {
+        blocks[index].freed_pass = blocks[next].freed_pass;
+    }
+    blocks[index].next = blocks[next].next;
+    if (blocks[next].next != NO_BLOCK) {
+        blocks[blocks[next].next].prev = index;
+    }
+    radix_set(pool, blocks[next].offset, NO_BLOCK);
+    free_list_unlink(pool, next);
+    release_block(pool, next);
+    pool->free_count--;
+}
+
+// Free a block and merge it with free neighbours
+void mempool_free(MemPool* pool, void* ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    uint32_t index = find_block(pool, ptr);
+    if (index == NO_BLOCK) {
+        pthread_mutex_unlock(&pool->lock);
+        fprintf(stderr, "mempool: invalid free of %p\n", ptr);
+        abort();
+    }
+
+    PoolBlock* blocks = pool->blocks;
+    blocks[index].is_free = true;
+    blocks[index].released = false;
+    blocks[index].freed_pass = pool->scavenge_passes;
+    pool->used -= (size_t)blocks[index].size << pool->granule_shift;
+    pool->free_count++;
+    pool->frees++;
+    free_list_insert(pool, index);
+
+    if (blocks[index].next != NO_BLOCK && blocks[blocks[index].next].is_free) {
+        absorb_next(pool, index);
+    }
+    if (blocks[index].prev != NO_BLOCK && blocks[blocks[index].prev].is_free) {
+        absorb_next(pool, blocks[index].prev);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+size_t mempool_block_size(MemPool* pool, void* ptr) {
+    pthread_mutex_lock(&pool->lock);
+    uint32_t index = find_block(pool, ptr);
+    size_t size = index != NO_BLOCK ? (size_t)pool->blocks[index].size << pool->granule_shift : 0;
+    pthread_mutex_unlock(&pool->lock);
+    return size;
+}
+
+bool mempool_owns(const MemPool* pool, const void* ptr) {
+    return (const char*)ptr >= pool->base && (const char*)ptr < pool->base + pool->size;
+}
+
+void* mempool_base(const MemPool* pool) {
+    return pool->base;
+}
+
+void mempool_stats(MemPool* pool, MemPoolStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+
+    pthread_mutex_lock(&pool->lock);
+    stats->size = pool->size;
+    stats->granule = (size_t)1 << pool->granule_shift;
+    stats->page_size = pool->page_size;
+    stats->pages = pool->pages;
+    stats->numa_node = pool->numa_node;
+    stats->used = pool->used;
+    stats->free_blocks = pool->free_count;
+    stats->used_blocks = pool->block_count - pool->free_count;
+    stats->allocations = pool->allocations;
+    stats->frees = pool->frees;
+    stats->failed_allocations = pool->failed_allocations;
+    stats->released_bytes = pool->released_bytes;
+    stats->scavenge_passes = pool->scavenge_passes;
+    stats->metadata_bytes = (size_t)pool->block_top * sizeof(PoolBlock) +
+                            (size_t)pool->radix_leaves * RADIX_LEAF_SIZE * sizeof(uint32_t);
+    for (uint32_t current = pool->free_head; current != NO_BLOCK; current = pool->blocks[current].free_next) {
+        size_t bytes = (size_t)pool->blocks[current].size << pool->granule_shift;
+        if (bytes > stats->largest_free) {
+            stats->largest_free = bytes;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    stats->resident = mempool_resident(pool);
+}
+
+// Bytes of the region currently resident in memory, counted with mincore()
+size_t mempool_resident(MemPool* pool) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t pages = pool->size / page;
+    size_t resident = 0;
+    unsigned char vector[4096];
+
+    for (size_t first = 0; first < pages; first += sizeof(vector)) {
+        size_t count = pages - first < sizeof(vector) ? pages - first : sizeof(vector);
+        if (mincore(pool->base + first * page, count * page, vector) != 0) {
+            break;
+        }
+        for (size_t i = 0; i < count; i++) {
+            resident += vector[i] & 1;
+        }
+    }
+    return resident * page;
+}
+
+// Page-aligned interior of a free block, the part that can be released
+// without touching its neighbours. Returns 0 bytes if there is none.
+static size_t block_interior(MemPool* pool, const PoolBlock* block, char** start) {
+    size_t first = round_up((size_t)block->offset << pool->granule_shift, pool->page_size);
+    size_t end = ((size_t)block->offset + block->size) << pool->granule_shift;
+    end -= end % pool->page_size;
+    *start = pool->base + first;
+    return end > first ? end - first : 0;
+}
+
+// One scavenger pass, with hysteresis: nothing happens until the resident
+// free memory exceeds the high watermark, and then interiors are released
+// until it is back under the low watermark. Blocks freed since the previous
+// pass are left alone, so memory that is about to be reused is not
+// released and faulted straight back in. Caller holds the lock.
+static size_t scavenge_locked(MemPool* pool, size_t high_watermark, size_t low_watermark) {
+    const MemPoolScavengeOptions* options = &pool->scavenge;
+    PoolBlock* blocks = pool->blocks;
+    size_t dirty = 0, released = 0;
+    char* start;
+
+    for (uint32_t current = pool->free_head; current != NO_BLOCK; current = blocks[current].free_next) {
+        if (!blocks[current].released) {
+            dirty += block_interior(pool, &blocks[current], &start);
+        }
+    }
+
+    if (dirty > high_watermark) {
+        for (uint32_t current = pool->free_head; current != NO_BLOCK && dirty > low_watermark;
+             current = blocks[current].free_next) {
+            PoolBlock* block = &blocks[current];
+            if (block->released || block->freed_pass == pool->scavenge_passes) {
+                continue;
+            }
+            size_t bytes = block_interior(pool, block, &start);
+            if (bytes < options->min_release) {
+                continue;
+            }
+            if (madvise(start, bytes, options->use_madv_free ? MADV_FREE : MADV_DONTNEED) == 0) {
+                block->released = true;
+                dirty -= bytes;
+                released += bytes;
+            }
+        }
+    }
+
+    pool->released_bytes += released;
+    pool->scavenge_passes++;
+    return released;
+}
+
+// Release every eligible free interior now, ignoring the watermarks
+size_t mempool_scavenge(MemPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    if (pool->scavenge.min_release == 0) {
+        pool->scavenge.min_release = pool->page_size;
+    }
+    pool->scavenge_passes++;    // Make every free block old enough
+    size_t released = scavenge_locked(pool, 0, 0);
+    pthread_mutex_unlock(&pool->lock);
+    return released;
+}
+
+static void* scavenger_thread(void* arg) {
+    MemPool* pool = (MemPool*)arg;
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->scavenger_running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += pool->scavenge.interval_ms / 1000;
+        deadline.tv_nsec += (long)(pool->scavenge.interval_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&pool->scavenger_wakeup, &pool->lock, &deadline);
+        if (pool->scavenger_running) {
+            scavenge_locked(pool, pool->scavenge.high_watermark, pool->scavenge.low_watermark);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// Start a background thread that runs a scavenger pass every interval.
+// `options` may be NULL for the defaults. Returns false if the thread
+// could not be started or one is already running.
+bool mempool_start_scavenger(MemPool* pool, const MemPoolScavengeOptions* options) {
+    MemPoolScavengeOptions defaults = {
+        MEMPOOL_SCAVENGE_MIN_RELEASE, MEMPOOL_SCAVENGE_HIGH_WATERMARK,
+        MEMPOOL_SCAVENGE_LOW_WATERMARK, MEMPOOL_SCAVENGE_INTERVAL_MS, false
+    };
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->scavenger_running) {
+        pthread_mutex_unlock(&pool->lock);
+        return false;
+    }
+    pool->scavenge = options != NULL ? *options : defaults;
+    if (pool->scavenge.min_release < pool->page_size) {
+        pool->scavenge.min_release = pool->page_size;
+    }
+    if (pool->scavenge.low_watermark > pool->scavenge.high_watermark) {
+        pool->scavenge.low_watermark = pool->scavenge.high_watermark;
+    }
+    if (pool->scavenge.interval_ms == 0) {
+        pool->scavenge.interval_ms = MEMPOOL_SCAVENGE_INTERVAL_MS;
+    }
+    pool->scavenger_running = true;
+    pthread_mutex_unlock(&pool->lock);
+
+    // Outside the lock: pthread_create may call malloc, which may be this pool
+    if (pthread_create(&pool->scavenger, NULL, scavenger_thread, pool) != 0) {
+        pthread_mutex_lock(&pool->lock);
+        pool->scavenger_running = false;
+        pthread_mutex_unlock(&pool->lock);
+        return false;
+    }
+    return true;
+}
+
+void mempool_stop_scavenger(MemPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    if (!pool->scavenger_running) {
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+    pool->scavenger_running = false;
+    pthread_cond_signal(&pool->scavenger_wakeup);
+    pthread_mutex_unlock(&pool->lock);
+    pthread_join(pool->scavenger, NULL);
+}
+
+// Fork safety: hold the pool lock across fork() so the child never sees a
+// half-updated block list. The child gets a fresh lock and, since threads
+// do not survive fork(), no scavenger.
+void mempool_prefork(MemPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+}
+
+void mempool_postfork_parent(MemPool* pool) {
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void mempool_postfork_child(MemPool* pool) {
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->scavenger_wakeup, NULL);
+    pool->scavenger_running = false;
+}
@@ -0,0 +1,104 @@
+#ifndef MEMPOOL_H
+#define MEMPOOL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Variable-partition allocator over a real anonymous mapping. It uses the
+// same best-fit placement (first and worst fit are options) and neighbour
+// merging as the simulator, but hands out pointers into the mapped region
+// instead of integer offsets. Block descriptors live in a separate table
+// and a radix tree maps a pointer back to its descriptor in constant time,
+// so user data is never interleaved with allocator headers and the pool
+// never calls malloc. Pools are limited to 2^32 granules (64 GB with the
+// default granule). All functions are thread-safe.
+
+#define MEMPOOL_GRANULE 16           // Default allocation unit and alignment in bytes
+#define MEMPOOL_SCAVENGE_MIN_RELEASE (256u << 10)     // Smallest interior worth releasing
+#define MEMPOOL_SCAVENGE_HIGH_WATERMARK (64u << 20)   // Resident free bytes that start a release
+#define MEMPOOL_SCAVENGE_LOW_WATERMARK (16u << 20)    // Resident free bytes a release stops at
+#define MEMPOOL_SCAVENGE_INTERVAL_MS 100
+
+typedef struct MemPool MemPool;
+
+typedef enum MemPoolPages {
+    MEMPOOL_PAGES_DEFAULT,          // Base pages
+    MEMPOOL_PAGES_TRANSPARENT,      // madvise(MADV_HUGEPAGE) on a huge-page aligned region
+    MEMPOOL_PAGES_HUGETLB           // MAP_HUGETLB from the reserved huge page pool
+} MemPoolPages;
+
+// Which free block an allocation is placed in
+typedef enum MemPoolFit {
+    MEMPOOL_FIT_BEST,               // Smallest block that fits, as in the simulator
+    MEMPOOL_FIT_FIRST,              // Lowest-addressed block that fits
+    MEMPOOL_FIT_WORST               // Largest block
+} MemPoolFit;
+
+typedef struct MemPoolOptions {
+    MemPoolPages pages;
+    int numa_node;              // Bind the region to this node, -1 for no binding
+    size_t granule;             // Power of two >= MEMPOOL_GRANULE, 0 for the default.
+                                // Use the page size to keep every block page aligned.
+    MemPoolFit fit;
+} MemPoolOptions;
+
+// Background release of free memory back to the OS
+typedef struct MemPoolScavengeOptions {
+    size_t min_release;         // Only release page-aligned interiors at least this big
+    size_t high_watermark;      // Start releasing when this much free memory is resident
+    size_t low_watermark;       // Stop once resident free memory is down to this
+    unsigned interval_ms;       // Time between passes
+    bool use_madv_free;         // MADV_FREE (lazy) instead of MADV_DONTNEED
+} MemPoolScavengeOptions;
+
+typedef struct MemPoolStats {
+    size_t size;                // Bytes in the region
+    size_t granule;
+    size_t page_size;           // Page size backing the region
+    MemPoolPages pages;         // Page mode in use (HUGETLB falls back to TRANSPARENT)
+    int numa_node;
+    size_t used;                // Bytes in allocated blocks
+    size_t largest_free;        // Largest free block in bytes
+    size_t metadata_bytes;      // Descriptor table and radix leaves in use
+    size_t resident;            // Bytes of the region resident in memory
+    size_t released_bytes;      // Returned to the OS by the scavenger so far
+    unsigned scavenge_passes;
+    int free_blocks;
+    int used_blocks;
+    long allocations;
+    long frees;
+    long failed_allocations;
+} MemPoolStats;
+
+// Map a region of at least `size` bytes. Returns NULL with errno set if
+// mapping or NUMA binding fails. `options` may be NULL for the defaults.
+MemPool* mempool_create(size_t size);
+MemPool* mempool_create_ex(size_t size, const MemPoolOptions* options);
+void mempool_destroy(MemPool* pool);
+
+// Allocate `size` bytes, aligned to the pool's granule (or to `alignment`,
+// a power of two). Returns NULL when no free block is large enough.
+void* mempool_alloc(MemPool* pool, size_t size);
+void* mempool_alloc_aligned(MemPool* pool, size_t alignment, size_t size);
+void mempool_free(MemPool* pool, void* ptr);
+
+// Usable size of an allocated block (its size rounded up to the granule)
+size_t mempool_block_size(MemPool* pool, void* ptr);
+bool mempool_owns(const MemPool* pool, const void* ptr);
+void* mempool_base(const MemPool* pool);
+void mempool_stats(MemPool* pool, MemPoolStats* stats);
+size_t mempool_resident(MemPool* pool);
+
+// Return the page-aligned interiors of large free blocks to the OS. The
+// pages read back as zero when they are next used. mempool_scavenge does
+// it once, now; the scavenger thread does it periodically with hysteresis.
+size_t mempool_scavenge(MemPool* pool);
+bool mempool_start_scavenger(MemPool* pool, const MemPoolScavengeOptions* options);
+void mempool_stop_scavenger(MemPool* pool);
+
+// pthread_atfork handlers for processes that fork while using a pool
+void mempool_prefork(MemPool* pool);
+void mempool_postfork_parent(MemPool* pool);
+void mempool_postfork_child(MemPool* pool);
+
+#endif
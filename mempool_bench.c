@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "mempool.h"
+
+// Allocate/free throughput of each placement engine under several request
+// patterns, with the heap already cut into a given number of fragments.
+//
+//   ./mempool_bench [--reps N] [--max-fragments N] [--json FILE]
+//
+// For a fragment count N the pool is first carved into N free holes of
+// mixed sizes separated by allocated blocks, which is what a long-running
+// heap looks like and what every placement search has to get past. Each
+// pattern then runs on top of that heap and gives back everything it
+// allocated, so the next repetition starts from the same state. The
+// results go to stdout as a table and, with --json, to a file for
+// regression tracking.
+
+#define BENCH_POOL_SIZE (1ul << 30)
+#define BENCH_MAX_OPS 100000            // Measured operations per repetition...
+#define BENCH_OP_BUDGET 200000000ul     // ...capped so ops * fragments stays bounded
+#define BENCH_MIN_OPS 200
+#define BENCH_DEFAULT_REPS 5
+#define BENCH_MAX_REPS 64
+#define BENCH_DEFAULT_MAX_FRAGMENTS 1000000
+#define BENCH_WINDOW 256                // Blocks in flight for the steady-state patterns
+#define BENCH_BURST 32                  // LIFO burst length
+
+typedef enum BenchPattern {
+    PATTERN_LIFO,       // Bursts allocated and freed in reverse order
+    PATTERN_FIFO,       // A queue: the oldest block is freed first
+    PATTERN_RANDOM,     // Random frees and allocations, 16-512 bytes
+    PATTERN_BIMODAL,    // As random, but 90% small and 10% large blocks
+    PATTERN_RAMP,       // Growing sizes all the way up, then freed at random
+    PATTERN_COUNT
+} BenchPattern;
+
+typedef struct BenchCell {
+    BenchPattern pattern;
+    long fragments;
+    MemPoolFit fit;
+    long ops;
+    int reps;
+    double samples[BENCH_MAX_REPS];     // ns/op of each repetition
+    double mean, stddev, min;
+    long failed;
+} BenchCell;
+
+static const char* pattern_names[PATTERN_COUNT] = { "lifo", "fifo", "random", "bimodal", "ramp" };
+static const char* fit_names[] = { "best", "first", "worst" };
+
+static uint64_t rng_state;
+
+static uint64_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static size_t random_size(size_t low, size_t high) {
+    return low + next_random() % (high - low + 1);
+}
+
+static double now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+// Carve the pool into `fragments` free holes of 16-256 bytes, each kept
+// apart by a small allocated block. Allocations come off the end of the
+// heap, so this is linear in the fragment count whatever the engine.
+static void **fragment_pool(MemPool* pool, long fragments) {
+    void** separators = malloc((size_t)fragments * sizeof(void*));
+    void** holes = malloc((size_t)fragments * sizeof(void*));
+
+    for (long i = 0; i < fragments; i++) {
+        holes[i] = mempool_alloc(pool, random_size(16, 256));
+        separators[i] = mempool_alloc(pool, 16);
+    }
+    for (long i = 0; i < fragments; i++) {
+        mempool_free(pool, holes[i]);
+    }
+    free(holes);
+    return separators;
+}
+
+static size_t pattern_size(BenchPattern pattern) {
+    if (pattern == PATTERN_BIMODAL) {
+        return next_random() % 10 == 0 ? random_size(4096, 32768) : random_size(16, 128);
+    }
+    return random_size(16, 512);
+}
+
+// Run `ops` operations of a pattern and return the ns spent on them. The
+// blocks still held at the end are freed outside the timed region.
+static double run_pattern(MemPool* pool, BenchPattern pattern, long ops, void** slots, long* failed) {
+    long held = 0, head = 0, done = 0;
+
+    memset(slots, 0, BENCH_WINDOW * sizeof(void*));
+    double start = now_ns();
+
+    switch (pattern) {
+        case PATTERN_LIFO:
+            while (done < ops) {
+                for (held = 0; held < BENCH_BURST && done < ops; held++, done++) {
+                    slots[held] = mempool_alloc(pool, pattern_size(pattern));
+                    *failed += slots[held] == NULL;
+                }
+                while (held > 0 && done < ops) {
+                    mempool_free(pool, slots[--held]);
+                    done++;
+                }
+            }
+            break;
+        case PATTERN_FIFO:
+            // slots is a ring of BENCH_WINDOW entries; head is the oldest
+            for (; done < ops; done++) {
+                if (held == BENCH_WINDOW) {
+                    mempool_free(pool, slots[head]);
+                    head = (head + 1) % BENCH_WINDOW;
+                    held--;
+                } else {
+                    long tail = (head + held) % BENCH_WINDOW;
+                    slots[tail] = mempool_alloc(pool, pattern_size(pattern));
+                    *failed += slots[tail] == NULL;
+                    held++;
+                }
+            }
+            break;
+        case PATTERN_RANDOM:
+        case PATTERN_BIMODAL:
+            for (; done < ops; done++) {
+                long slot = (long)(next_random() % BENCH_WINDOW);
+                if (slots[slot] != NULL) {
+                    mempool_free(pool, slots[slot]);
+                    slots[slot] = NULL;
+                } else {
+                    slots[slot] = mempool_alloc(pool, pattern_size(pattern));
+                    *failed += slots[slot] == NULL;
+                }
+            }
+            break;
+        case PATTERN_RAMP:
+            // Up with sizes growing from 16 bytes to 8 KB, then down in a
+            // random order
+            for (held = 0; held < ops / 2; held++) {
+                slots[held] = mempool_alloc(pool, 16 + (size_t)held * 8192 / (size_t)(ops / 2));
+                *failed += slots[held] == NULL;
+            }
+            for (long i = held - 1; i > 0; i--) {
+                long j = (long)(next_random() % (uint64_t)(i + 1));
+                void* swap = slots[i];
+                slots[i] = slots[j];
+                slots[j] = swap;
+            }
+            while (held > 0) {
+                mempool_free(pool, slots[--held]);
+            }
+            break;
+        default:
+            break;
+    }
+    double elapsed = now_ns() - start;
+
+    // Give back what is still held so the heap is as it was
+    if (pattern == PATTERN_LIFO || pattern == PATTERN_FIFO) {
+        for (long i = 0; i < held; i++) {
+            mempool_free(pool, slots[pattern == PATTERN_FIFO ? (head + i) % BENCH_WINDOW : i]);
+        }
+    } else if (pattern != PATTERN_RAMP) {
+        for (long i = 0; i < BENCH_WINDOW; i++) {
+            mempool_free(pool, slots[i]);
+        }
+    }
+    return elapsed;
+}
+
+static void summarize(BenchCell* cell) {
+    double sum = 0.0, squares = 0.0;
+
+    cell->min = cell->samples[0];
+    for (int i = 0; i < cell->reps; i++) {
+        sum += cell->samples[i];
+        if (cell->samples[i] < cell->min) {
+            cell->min = cell->samples[i];
+        }
+    }
+    cell->mean = sum / cell->reps;
+    for (int i = 0; i < cell->reps; i++) {
+        squares += (cell->samples[i] - cell->mean) * (cell->samples[i] - cell->mean);
+    }
+    cell->stddev = cell->reps > 1 ? sqrt(squares / (cell->reps - 1)) : 0.0;
+}
+
+static void write_json(const char* path, const BenchCell* cells, int count, int reps) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        return;
+    }
+    fprintf(file, "{\n  \"benchmark\": \"mempool\",\n  \"reps\": %d,\n  \"results\": [\n", reps);
+    for (int i = 0; i < count; i++) {
+        const BenchCell* cell = &cells[i];
+        fprintf(file, "    {\"pattern\": \"%s\", \"fragments\": %ld, \"fit\": \"%s\", \"ops\": %ld, "
+                      "\"ns_per_op\": %.3f, \"stddev\": %.3f, \"min\": %.3f, \"failed\": %ld, \"samples\": [",
+                pattern_names[cell->pattern], cell->fragments, fit_names[cell->fit], cell->ops,
+                cell->mean, cell->stddev, cell->min, cell->failed);
+        for (int r = 0; r < cell->reps; r++) {
+            fprintf(file, "%s%.3f", r > 0 ? ", " : "", cell->samples[r]);
+        }
+        fprintf(file, "]}%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+}
+
+int main(int argc, char* argv[]) {
+    int reps = BENCH_DEFAULT_REPS;
+    long max_fragments = BENCH_DEFAULT_MAX_FRAGMENTS;
+    const char* json_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-fragments") == 0 && i + 1 < argc) {
+            max_fragments = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--reps N] [--max-fragments N] [--json FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (reps < 1 || reps > BENCH_MAX_REPS) {
+        fprintf(stderr, "--reps must be between 1 and %d\n", BENCH_MAX_REPS);
+        return 1;
+    }
+
+    int capacity = 0, count = 0;
+    for (long fragments = 10; fragments <= max_fragments; fragments *= 10) {
+        capacity += PATTERN_COUNT * (MEMPOOL_FIT_WORST + 1);
+    }
+    BenchCell* cells = calloc((size_t)capacity, sizeof(BenchCell));
+    void** slots = calloc(BENCH_MAX_OPS, sizeof(void*));
+
+    printf("\n--- Pool Allocator Microbenchmark (%d repetitions, ns/op) ---\n", reps);
+    printf("+---------+-----------+--------+--------+----------------------+----------------------+----------------------+\n");
+    printf("| Pattern | Fragments | Ops    | Failed | Best fit             | First fit            | Worst fit            |\n");
+    printf("+---------+-----------+--------+--------+----------------------+----------------------+----------------------+\n");
+
+    for (long fragments = 10; fragments <= max_fragments; fragments *= 10) {
+        long ops = (long)(BENCH_OP_BUDGET / (unsigned long)fragments);
+        ops = ops > BENCH_MAX_OPS ? BENCH_MAX_OPS : ops < BENCH_MIN_OPS ? BENCH_MIN_OPS : ops;
+        BenchCell* row = &cells[count];
+
+        for (MemPoolFit fit = MEMPOOL_FIT_BEST; fit <= MEMPOOL_FIT_WORST; fit++) {
+            MemPoolOptions options = { MEMPOOL_PAGES_DEFAULT, -1, 0, fit };
+            MemPool* pool = mempool_create_ex(BENCH_POOL_SIZE, &options);
+            if (pool == NULL) {
+                perror("mempool_create_ex");
+                return 1;
+            }
+            rng_state = 0x9e3779b97f4a7c15ull;
+            void** separators = fragment_pool(pool, fragments);
+
+            for (BenchPattern pattern = 0; pattern < PATTERN_COUNT; pattern++) {
+                BenchCell* cell = &row[pattern * (MEMPOOL_FIT_WORST + 1) + fit];
+                cell->pattern = pattern;
+                cell->fragments = fragments;
+                cell->fit = fit;
+                cell->ops = ops;
+                cell->reps = reps;
+                // Same request stream for every engine
+                rng_state = 0x2545f4914f6cdd1dull + (uint64_t)pattern;
+                run_pattern(pool, pattern, ops, slots, &cell->failed);     // Warm-up
+                cell->failed = 0;
+                for (int r = 0; r < reps; r++) {
+                    cell->samples[r] = run_pattern(pool, pattern, ops, slots, &cell->failed) / ops;
+                }
+                summarize(cell);
+            }
+            for (long i = 0; i < fragments; i++) {
+                mempool_free(pool, separators[i]);
+            }
+            free(separators);
+            mempool_destroy(pool);
+        }
+
+        for (BenchPattern pattern = 0; pattern < PATTERN_COUNT; pattern++) {
+            const BenchCell* fits = &row[pattern * (MEMPOOL_FIT_WORST + 1)];
+            printf("| %-7s | %9ld | %6ld | %6ld |", pattern_names[pattern], fragments, ops,
+                   fits[0].failed + fits[1].failed + fits[2].failed);
+            for (int fit = 0; fit <= MEMPOOL_FIT_WORST; fit++) {
+                printf(" %11.1f +- %4.1f%% |", fits[fit].mean,
+                       fits[fit].mean > 0 ? 100.0 * fits[fit].stddev / fits[fit].mean : 0.0);
+            }
+            printf("\n");
+        }
+        count += PATTERN_COUNT * (MEMPOOL_FIT_WORST + 1);
+        fflush(stdout);
+    }
+    printf("+---------+-----------+--------+--------+----------------------+----------------------+----------------------+\n");
+
+    if (json_path != NULL) {
+        write_json(json_path, cells, count, reps);
+        printf("Results written to %s\n", json_path);
+    }
+    free(slots);
+    free(cells);
+    return 0;
+}
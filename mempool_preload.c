@@ -0,0 +1,344 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <malloc.h>
+#include <time.h>
+#include "mempool.h"
+#include "mempool_trace.h"
+
+// LD_PRELOAD shim that replaces the malloc family with a MemPool, so real
+// programs can run on the simulator's allocation engine:
+//
+//   LD_PRELOAD=./libmempool_preload.so MEMPOOL_FIT=first ls -l
+//
+// Environment:
+//   MEMPOOL_SIZE      pool size, with an optional K/M/G suffix (default 1G)
+//   MEMPOOL_FIT       best, first or worst (default best)
+//   MEMPOOL_PAGES     default, thp or hugetlb
+//   MEMPOOL_SCAVENGE  1 to run the background scavenger
+//   MEMPOOL_STATS     1 to print pool statistics to stderr at exit
+//   MEMPOOL_TRACE     file to record every pool allocation and free in, for
+//                     mempool_replay (the parent process only: forked
+//                     children stop tracing)
+
+#define DEFAULT_PRELOAD_POOL_SIZE (1ul << 30)
+#define BOOTSTRAP_BYTES (256u << 10)    // Serves allocations made while the pool is being set up
+#define TRACE_BUFFER_RECORDS 4096
+
+enum { POOL_UNINITIALIZED, POOL_INITIALIZING, POOL_READY, POOL_FAILED };
+
+static MemPool* pool;
+static atomic_int pool_state = POOL_UNINITIALIZED;
+static __thread bool initializing_thread;
+static int stats_fd = -1;       // Copy of stderr, which programs like ls close before exiting
+
+// Bump allocator for calls that arrive before the pool exists, for example
+// from the dynamic loader or from pthread_atfork() during setup. Blocks
+// carry their size in front and are never reused.
+static _Alignas(64) char bootstrap[BOOTSTRAP_BYTES];
+static atomic_size_t bootstrap_used;
+
+static void* bootstrap_alloc(size_t size) {
+    size_t total = 16 + ((size + 15) & ~(size_t)15);
+    size_t offset = atomic_fetch_add(&bootstrap_used, total);
+    if (offset + total > BOOTSTRAP_BYTES) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    *(size_t*)(bootstrap + offset) = size;
+    return bootstrap + offset + 16;
+}
+
+static bool is_bootstrap(const void* ptr) {
+    return (const char*)ptr >= bootstrap && (const char*)ptr < bootstrap + BOOTSTRAP_BYTES;
+}
+
+static size_t bootstrap_size(const void* ptr) {
+    return *(const size_t*)((const char*)ptr - 16);
+}
+
+// Trace records are buffered under their own lock and written out with
+// write(), which never allocates
+static int trace_fd = -1;
+static uint64_t trace_start_ns;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static MemPoolTraceRecord trace_buffer[TRACE_BUFFER_RECORDS];
+static int trace_count;
+
+static uint64_t monotonic_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+static void trace_flush_locked() {
+    size_t bytes = (size_t)trace_count * sizeof(MemPoolTraceRecord);
+    if (bytes > 0 && write(trace_fd, trace_buffer, bytes) != (ssize_t)bytes) {
+        close(trace_fd);
+        trace_fd = -1;
+    }
+    trace_count = 0;
+}
+
+static void trace(MemPoolTraceOp op, const void* ptr, size_t size) {
+    if (trace_fd < 0) {
+        return;
+    }
+    pthread_mutex_lock(&trace_lock);
+    if (trace_fd >= 0) {
+        MemPoolTraceRecord* record = &trace_buffer[trace_count++];
+        record->time_ns = monotonic_ns() - trace_start_ns;
+        record->address = (uint64_t)(uintptr_t)ptr;
+        record->size = size;
+        record->op = op;
+        if (trace_count == TRACE_BUFFER_RECORDS) {
+            trace_flush_locked();
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+static void trace_open(const char* path) {
+    MemPoolTraceHeader header = { MEMPOOL_TRACE_MAGIC, MEMPOOL_TRACE_VERSION,
+                                  sizeof(MemPoolTraceRecord), (uint32_t)getpid() };
+
+    trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (trace_fd >= 0 && write(trace_fd, &header, sizeof(header)) != sizeof(header)) {
+        close(trace_fd);
+        trace_fd = -1;
+    }
+    trace_start_ns = monotonic_ns();
+}
+
+static void trace_close() {
+    pthread_mutex_lock(&trace_lock);
+    if (trace_fd >= 0) {
+        trace_flush_locked();
+        close(trace_fd);
+        trace_fd = -1;
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+static size_t parse_size(const char* text, size_t fallback) {
+    if (text == NULL || *text == '\0') {
+        return fallback;
+    }
+    char* end;
+    size_t value = strtoul(text, &end, 10);
+    switch (*end) {
+        case 'k': case 'K': value <<= 10; break;
+        case 'm': case 'M': value <<= 20; break;
+        case 'g': case 'G': value <<= 30; break;
+    }
+    return value > 0 ? value : fallback;
+}
+
+static void prefork() {
+    pthread_mutex_lock(&trace_lock);
+    mempool_prefork(pool);
+}
+
+static void postfork_parent() {
+    mempool_postfork_parent(pool);
+    pthread_mutex_unlock(&trace_lock);
+}
+
+// The child shares the trace file with the parent, so it drops its copy
+// of the buffer and closes its descriptor rather than interleave records
+static void postfork_child() {
+    mempool_postfork_child(pool);
+    pthread_mutex_init(&trace_lock, NULL);
+    if (trace_fd >= 0) {
+        close(trace_fd);
+        trace_fd = -1;
+        trace_count = 0;
+    }
+}
+
+// Finish the trace, then print the statistics if asked to
+static void report_at_exit() {
+    MemPoolStats stats;
+    char line[512];
+
+    trace_close();
+    if (pool == NULL || stats_fd < 0) {
+        return;
+    }
+    mempool_stats(pool, &stats);
+    int length = snprintf(line, sizeof(line),
+                          "mempool: %ld allocations, %ld frees, %ld failed, %zu KB used, "
+                          "%zu KB resident, %d free blocks, largest free %zu KB, "
+                          "%zu KB metadata, %zu KB released\n",
+                          stats.allocations, stats.frees, stats.failed_allocations,
+                          stats.used >> 10, stats.resident >> 10, stats.free_blocks,
+                          stats.largest_free >> 10, stats.metadata_bytes >> 10,
+                          stats.released_bytes >> 10);
+    if (length > 0 && write(stats_fd, line, (size_t)length) < 0) {
+        return;
+    }
+}
+
+// Create the pool on first use. The thread doing it is marked, so any
+// allocation it makes on the way (pthread_atfork, atexit) is served from
+// the bootstrap area instead of recursing. Other threads wait.
+static bool ensure_pool() {
+    int state = atomic_load_explicit(&pool_state, memory_order_acquire);
+    if (state == POOL_READY) {
+        return true;
+    }
+
+    int expected = POOL_UNINITIALIZED;
+    if (atomic_compare_exchange_strong(&pool_state, &expected, POOL_INITIALIZING)) {
+        const char* fit = getenv("MEMPOOL_FIT");
+        const char* pages = getenv("MEMPOOL_PAGES");
+        MemPoolOptions options = { MEMPOOL_PAGES_DEFAULT, -1, 0, MEMPOOL_FIT_BEST };
+
+        if (fit != NULL && strcmp(fit, "first") == 0) options.fit = MEMPOOL_FIT_FIRST;
+        if (fit != NULL && strcmp(fit, "worst") == 0) options.fit = MEMPOOL_FIT_WORST;
+        if (pages != NULL && strcmp(pages, "thp") == 0) options.pages = MEMPOOL_PAGES_TRANSPARENT;
+        if (pages != NULL && strcmp(pages, "hugetlb") == 0) options.pages = MEMPOOL_PAGES_HUGETLB;
+
+        initializing_thread = true;
+        pool = mempool_create_ex(parse_size(getenv("MEMPOOL_SIZE"), DEFAULT_PRELOAD_POOL_SIZE), &options);
+        if (pool != NULL) {
+            pthread_atfork(prefork, postfork_parent, postfork_child);
+            if (getenv("MEMPOOL_STATS") != NULL) {
+                stats_fd = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 3);
+            }
+            if (getenv("MEMPOOL_TRACE") != NULL) {
+                trace_open(getenv("MEMPOOL_TRACE"));
+            }
+            // Registered first so it runs after the program's own handlers
+            atexit(report_at_exit);
+        }
+        initializing_thread = false;
+        atomic_store_explicit(&pool_state, pool != NULL ? POOL_READY : POOL_FAILED, memory_order_release);
+
+        // Started once the pool is ready: creating the thread allocates
+        if (pool != NULL && getenv("MEMPOOL_SCAVENGE") != NULL) {
+            mempool_start_scavenger(pool, NULL);
+        }
+        return pool != NULL;
+    }
+
+    if (initializing_thread) {
+        return false;
+    }
+    while ((state = atomic_load_explicit(&pool_state, memory_order_acquire)) == POOL_INITIALIZING) {
+        sched_yield();
+    }
+    return state == POOL_READY;
+}
+
+void* malloc(size_t size) {
+    if (!ensure_pool()) {
+        return bootstrap_alloc(size);
+    }
+    void* ptr = mempool_alloc(pool, size);
+    if (ptr == NULL) {
+        errno = ENOMEM;
+    } else {
+        trace(MEMPOOL_TRACE_ALLOC, ptr, size);
+    }
+    return ptr;
+}
+
+void free(void* ptr) {
+    // Bootstrap blocks are never reused; pointers from anywhere else that
+    // is not the pool cannot be ours, so they are left alone
+    if (ptr == NULL || is_bootstrap(ptr) || pool == NULL || !mempool_owns(pool, ptr)) {
+        return;
+    }
+    trace(MEMPOOL_TRACE_FREE, ptr, 0);
+    mempool_free(pool, ptr);
+}
+
+void* calloc(size_t count, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(count, size, &total)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    void* ptr = malloc(total);
+    if (ptr != NULL && !is_bootstrap(ptr)) {
+        memset(ptr, 0, total);
+    }
+    return ptr;
+}
+
+static size_t block_size(void* ptr) {
+    if (is_bootstrap(ptr)) {
+        return bootstrap_size(ptr);
+    }
+    return pool != NULL && mempool_owns(pool, ptr) ? mempool_block_size(pool, ptr) : 0;
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return malloc(size);
+    }
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+
+    size_t old_size = block_size(ptr);
+    if (size <= old_size && !is_bootstrap(ptr)) {
+        return ptr;
+    }
+    void* moved = malloc(size);
+    if (moved != NULL) {
+        memcpy(moved, ptr, old_size < size ? old_size : size);
+        free(ptr);
+    }
+    return moved;
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    void* ptr = ensure_pool() ? mempool_alloc_aligned(pool, alignment, size) : NULL;
+    if (ptr == NULL) {
+        return ENOMEM;
+    }
+    trace(MEMPOOL_TRACE_ALLOC, ptr, size);
+    *result = ptr;
+    return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    void* ptr = NULL;
+    int error = posix_memalign(&ptr, alignment, size);
+    if (error != 0) {
+        errno = error;
+    }
+    return ptr;
+}
+
+// Unlike posix_memalign these accept any power of two, however small
+void* memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment < sizeof(void*) ? sizeof(void*) : alignment, size);
+}
+
+void* valloc(size_t size) {
+    return aligned_alloc((size_t)sysconf(_SC_PAGESIZE), size);
+}
+
+void* pvalloc(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return aligned_alloc(page, (size + page - 1) / page * page);
+}
+
+size_t malloc_usable_size(void* ptr) {
+    return ptr != NULL ? block_size(ptr) : 0;
+}
@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "mempool.h"
+#include "mempool_trace.h"
+
+// Replays an allocation trace recorded through the preload shim against
+// each placement engine of the memory pool, as fast as it will go:
+//
+//   MEMPOOL_TRACE=ls.trace LD_PRELOAD=./libmempool_preload.so ls -lR /usr
+//   ./mempool_replay ls.trace [pool size in MB]
+//
+// Every engine sees the identical sequence of requests. A first pass is
+// timed on its own; a second pass measures the peak footprint (the highest
+// pool offset in use) against the peak of live bytes, the difference being
+// what the engine lost to fragmentation.
+
+#define DEFAULT_REPLAY_POOL_MB 1024
+
+typedef struct Trace {
+    MemPoolTraceRecord* records;
+    size_t count;
+    uint64_t duration_ns;
+} Trace;
+
+// Open-addressing table from a recorded address to the replayed block
+typedef struct LiveTable {
+    uint64_t* keys;         // 0 marks an empty slot; recorded addresses are never 0
+    void** blocks;
+    size_t* sizes;
+    size_t mask;
+} LiveTable;
+
+typedef struct ReplayResult {
+    double seconds;
+    size_t peak_footprint;
+    size_t peak_live;
+    long failed;
+    long unmatched_frees;   // Frees of addresses the trace never allocated
+    MemPoolStats stats;     // At the end of the trace
+} ReplayResult;
+
+static const char* fit_names[] = { "Best fit", "First fit", "Worst fit" };
+
+static int load_trace(const char* path, Trace* trace) {
+    MemPoolTraceHeader header;
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != MEMPOOL_TRACE_MAGIC ||
+        header.version != MEMPOOL_TRACE_VERSION || header.record_size != sizeof(MemPoolTraceRecord)) {
+        fprintf(stderr, "%s: not a version %d allocation trace\n", path, MEMPOOL_TRACE_VERSION);
+        fclose(file);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long bytes = ftell(file) - (long)sizeof(header);
+    fseek(file, sizeof(header), SEEK_SET);
+
+    trace->count = (size_t)bytes / sizeof(MemPoolTraceRecord);
+    trace->records = malloc(trace->count * sizeof(MemPoolTraceRecord) + 1);
+    if (trace->records == NULL ||
+        fread(trace->records, sizeof(MemPoolTraceRecord), trace->count, file) != trace->count) {
+        fprintf(stderr, "%s: could not read %zu records\n", path, trace->count);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    trace->duration_ns = trace->count > 0 ? trace->records[trace->count - 1].time_ns : 0;
+    return 0;
+}
+
+static void live_table_init(LiveTable* table, size_t records) {
+    size_t capacity = 64;
+    while (capacity < 2 * records) {
+        capacity *= 2;
+    }
+    table->keys = calloc(capacity, sizeof(uint64_t));
+    table->blocks = malloc(capacity * sizeof(void*));
+    table->sizes = malloc(capacity * sizeof(size_t));
+    table->mask = capacity - 1;
+}
+
+static void live_table_free(LiveTable* table) {
+    free(table->keys);
+    free(table->blocks);
+    free(table->sizes);
+}
+
+static size_t live_slot(const LiveTable* table, uint64_t address) {
+    size_t slot = (size_t)((address >> 4) * 0x9e3779b97f4a7c15ull) & table->mask;
+    while (table->keys[slot] != 0 && table->keys[slot] != address) {
+        slot = (slot + 1) & table->mask;
+    }
+    return slot;
+}
+
+// Remove a slot and shift the rest of its probe run back, so lookups never
+// need tombstones
+static void live_remove(LiveTable* table, size_t slot) {
+    size_t next = slot;
+    for (;;) {
+        next = (next + 1) & table->mask;
+        if (table->keys[next] == 0) {
+            break;
+        }
+        size_t home = (size_t)((table->keys[next] >> 4) * 0x9e3779b97f4a7c15ull) & table->mask;
+        if (((next - home) & table->mask) >= ((next - slot) & table->mask)) {
+            table->keys[slot] = table->keys[next];
+            table->blocks[slot] = table->blocks[next];
+            table->sizes[slot] = table->sizes[next];
+            slot = next;
+        }
+    }
+    table->keys[slot] = 0;
+}
+
+// One pass over the trace. With `measure` set, also track the footprint
+// and live bytes, which costs a block lookup per allocation.
+static void replay(const Trace* trace, MemPool* pool, bool measure, ReplayResult* result) {
+    LiveTable table;
+    struct timespec start, end;
+    char* base = mempool_base(pool);
+    size_t live = 0;
+
+    memset(result, 0, sizeof(*result));
+    live_table_init(&table, trace->count);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < trace->count; i++) {
+        const MemPoolTraceRecord* record = &trace->records[i];
+        size_t slot = live_slot(&table, record->address);
+
+        if (table.keys[slot] != 0) {
+            // A free, or an allocation at an address whose free was not
+            // traced; either way the old block goes
+            mempool_free(pool, table.blocks[slot]);
+            live -= table.sizes[slot];
+            live_remove(&table, slot);
+            if (record->op == MEMPOOL_TRACE_ALLOC) {
+                slot = live_slot(&table, record->address);
+            }
+        } else if (record->op == MEMPOOL_TRACE_FREE) {
+            result->unmatched_frees++;
+        }
+        if (record->op != MEMPOOL_TRACE_ALLOC) {
+            continue;
+        }
+
+        char* block = mempool_alloc(pool, record->size);
+        if (block == NULL) {
+            result->failed++;
+            continue;
+        }
+        table.keys[slot] = record->address;
+        table.blocks[slot] = block;
+        table.sizes[slot] = record->size;
+        live += record->size;
+        if (measure) {
+            size_t end_offset = (size_t)(block - base) + mempool_block_size(pool, block);
+            if (end_offset > result->peak_footprint) {
+                result->peak_footprint = end_offset;
+            }
+            if (live > result->peak_live) {
+                result->peak_live = live;
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    result->seconds = (double)(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    mempool_stats(pool, &result->stats);
+    live_table_free(&table);
+}
+
+int main(int argc, char* argv[]) {
+    Trace trace;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s TRACE [pool size in MB]\n", argv[0]);
+        return 1;
+    }
+    if (load_trace(argv[1], &trace) != 0) {
+        return 1;
+    }
+    size_t pool_size = (size_t)(argc > 2 ? atol(argv[2]) : DEFAULT_REPLAY_POOL_MB) << 20;
+
+    long allocations = 0, unmatched_frees = 0;
+    for (size_t i = 0; i < trace.count; i++) {
+        allocations += trace.records[i].op == MEMPOOL_TRACE_ALLOC;
+    }
+    printf("\n--- Trace Replay: %s ---\n", argv[1]);
+    printf("%zu operations (%ld allocations), recorded over %.3f s, %zu MB pool\n",
+           trace.count, allocations, trace.duration_ns / 1e9, pool_size >> 20);
+    printf("+-----------+--------------+----------------+------------+---------------+-------------+--------+\n");
+    printf("| Engine    | Ops/sec      | Peak footprint | Peak live  | Fragmentation | Free blocks | Failed |\n");
+    printf("+-----------+--------------+----------------+------------+---------------+-------------+--------+\n");
+
+    for (MemPoolFit fit = MEMPOOL_FIT_BEST; fit <= MEMPOOL_FIT_WORST; fit++) {
+        MemPoolOptions options = { MEMPOOL_PAGES_DEFAULT, -1, 0, fit };
+        ReplayResult timed, measured;
+
+        MemPool* pool = mempool_create_ex(pool_size, &options);
+        if (pool == NULL) {
+            perror("mempool_create_ex");
+            return 1;
+        }
+        replay(&trace, pool, false, &timed);
+        mempool_destroy(pool);
+
+        pool = mempool_create_ex(pool_size, &options);
+        if (pool == NULL) {
+            perror("mempool_create_ex");
+            return 1;
+        }
+        replay(&trace, pool, true, &measured);
+        mempool_destroy(pool);
+
+        double fragmentation = measured.peak_footprint > 0
+            ? 100.0 * (1.0 - (double)measured.peak_live / measured.peak_footprint) : 0.0;
+        printf("| %-9s | %12.0f | %11zu KB | %7zu KB | %12.2f%% | %11d | %6ld |\n", fit_names[fit],
+               trace.count / (timed.seconds > 0 ? timed.seconds : 1e-9),
+               measured.peak_footprint >> 10, measured.peak_live >> 10, fragmentation,
+               measured.stats.free_blocks, measured.failed);
+        unmatched_frees = measured.unmatched_frees;
+    }
+    printf("+-----------+--------------+----------------+------------+---------------+-------------+--------+\n");
+    if (unmatched_frees > 0) {
+        printf("Skipped %ld frees of blocks allocated outside the trace\n", unmatched_frees);
+    }
+    free(trace.records);
+    return 0;
+}
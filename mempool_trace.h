@@ -0,0 +1,36 @@
+#ifndef MEMPOOL_TRACE_H
+#define MEMPOOL_TRACE_H
+
+#include <stdint.h>
+
+// Binary allocation trace written by the preload shim (MEMPOOL_TRACE=file)
+// and read by mempool_replay. A header is followed by fixed-size records
+// in the order the operations took effect: a free is logged before the
+// block is released and an allocation after it is placed, so an address is
+// never reused in the log before the free that made it available.
+
+#define MEMPOOL_TRACE_MAGIC 0x4352544du     // "MTRC" in a little-endian file
+#define MEMPOOL_TRACE_VERSION 1
+
+typedef struct MemPoolTraceHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;       // sizeof(MemPoolTraceRecord)
+    uint32_t pid;               // Process that wrote the trace
+} MemPoolTraceHeader;
+
+typedef enum MemPoolTraceOp {
+    MEMPOOL_TRACE_ALLOC,
+    MEMPOOL_TRACE_FREE
+} MemPoolTraceOp;
+
+typedef struct MemPoolTraceRecord {
+    uint64_t time_ns;           // Since the trace was opened
+    uint64_t address;
+    uint64_t size : 56;         // Requested bytes, 0 for a free
+    uint64_t op : 8;
+} MemPoolTraceRecord;
+
+_Static_assert(sizeof(MemPoolTraceRecord) == 24, "trace records are 24 bytes");
+
+#endif
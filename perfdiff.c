@@ -0,0 +1,403 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <math.h>
+
+// Compares two JSON result files written by the same benchmark (tes3 bench
+// or mempool_bench) and reports which results got slower:
+//
+//   ./perfdiff [--threshold PCT] BASELINE CURRENT
+//
+// Every result is matched to its baseline by its identifying fields. The
+// repetitions on each side give a mean and variance, and Welch's t-test
+// gives a 95% confidence interval for the change. A result counts as a
+// regression only when it is slower by more than the threshold and the
+// interval excludes zero, so run-to-run noise is not reported. The exit
+// status is 1 if anything regressed and 2 if a file could not be read.
+
+#define DEFAULT_THRESHOLD_PCT 10.0
+#define MAX_KEY_FIELDS 4
+#define MAX_SAMPLES 64
+
+typedef enum JsonType { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT } JsonType;
+
+typedef struct JsonValue {
+    JsonType type;
+    double number;
+    char* string;
+    char** keys;                // Object member names, NULL for arrays
+    struct JsonValue* items;
+    int count;
+} JsonValue;
+
+// What identifies a result and which samples to compare, per benchmark
+typedef struct BenchSchema {
+    const char* benchmark;
+    const char* key_fields[MAX_KEY_FIELDS];
+    const char* samples_field;
+    const char* unit;
+    bool higher_is_better;
+} BenchSchema;
+
+typedef struct Result {
+    char name[128];
+    double samples[MAX_SAMPLES];
+    int count;
+    double mean, variance;
+    bool matched;
+} Result;
+
+typedef struct ResultSet {
+    const BenchSchema* schema;
+    Result* results;
+    int count;
+} ResultSet;
+
+typedef enum Verdict { VERDICT_SAME, VERDICT_FASTER, VERDICT_SLOWER, VERDICT_REGRESSED } Verdict;
+
+static const BenchSchema schemas[] = {
+    { "mempool", { "pattern", "fragments", "fit" }, "samples", "ns/op", false },
+    { "simulation", { "trace", "compaction", "policy", "scheduling" }, "events_per_sec", "events/s", true },
+};
+
+static const char* verdict_names[] = { "same", "faster", "slower", "REGRESSED" };
+
+// Two-sided 95% critical values of Student's t for 1-30 degrees of freedom
+static const double t_table[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+static const char* parse_value(const char* p, JsonValue* value);
+
+static const char* skip_space(const char* p) {
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    return p;
+}
+
+// Strings in the benchmark output are plain names; escapes are kept as the
+// escaped character
+static const char* parse_string(const char* p, char** out) {
+    const char* start = ++p;
+    size_t length = 0;
+
+    while (*p != '"') {
+        if (*p == '\0') {
+            return NULL;
+        }
+        p += *p == '\\' && p[1] != '\0' ? 2 : 1;
+    }
+    *out = malloc((size_t)(p - start) + 1);
+    for (const char* c = start; c < p; c++) {
+        if (*c == '\\') {
+            c++;
+        }
+        (*out)[length++] = *c;
+    }
+    (*out)[length] = '\0';
+    return p + 1;
+}
+
+// Parse the members of an array or object, `p` just past the bracket
+static const char* parse_members(const char* p, JsonValue* value, char close) {
+    int capacity = 0;
+
+    p = skip_space(p);
+    if (*p == close) {
+        return p + 1;
+    }
+    for (;;) {
+        if (value->count == capacity) {
+            capacity = capacity ? capacity * 2 : 8;
+            value->items = realloc(value->items, capacity * sizeof(JsonValue));
+            if (close == '}') {
+                value->keys = realloc(value->keys, capacity * sizeof(char*));
+            }
+        }
+        p = skip_space(p);
+        if (close == '}') {
+            if (*p != '"' || (p = parse_string(p, &value->keys[value->count])) == NULL) {
+                return NULL;
+            }
+            p = skip_space(p);
+            if (*p++ != ':') {
+                return NULL;
+            }
+        }
+        if ((p = parse_value(p, &value->items[value->count])) == NULL) {
+            return NULL;
+        }
+        value->count++;
+        p = skip_space(p);
+        if (*p == close) {
+            return p + 1;
+        }
+        if (*p++ != ',') {
+            return NULL;
+        }
+    }
+}
+
+static const char* parse_value(const char* p, JsonValue* value) {
+    char* end;
+
+    memset(value, 0, sizeof(*value));
+    p = skip_space(p);
+    switch (*p) {
+        case '{':
+            value->type = JSON_OBJECT;
+            return parse_members(p + 1, value, '}');
+        case '[':
+            value->type = JSON_ARRAY;
+            return parse_members(p + 1, value, ']');
+        case '"':
+            value->type = JSON_STRING;
+            return parse_string(p, &value->string);
+        case 't':
+            value->type = JSON_BOOL;
+            value->number = 1;
+            return strncmp(p, "true", 4) == 0 ? p + 4 : NULL;
+        case 'f':
+            value->type = JSON_BOOL;
+            return strncmp(p, "false", 5) == 0 ? p + 5 : NULL;
+        case 'n':
+            return strncmp(p, "null", 4) == 0 ? p + 4 : NULL;
+        default:
+            value->type = JSON_NUMBER;
+            value->number = strtod(p, &end);
+            return end == p ? NULL : end;
+    }
+}
+
+static void json_free(JsonValue* value) {
+    for (int i = 0; i < value->count; i++) {
+        json_free(&value->items[i]);
+        if (value->keys != NULL) {
+            free(value->keys[i]);
+        }
+    }
+    free(value->items);
+    free(value->keys);
+    free(value->string);
+}
+
+static const JsonValue* json_get(const JsonValue* object, const char* key) {
+    if (object->type != JSON_OBJECT) {
+        return NULL;
+    }
+    for (int i = 0; i < object->count; i++) {
+        if (strcmp(object->keys[i], key) == 0) {
+            return &object->items[i];
+        }
+    }
+    return NULL;
+}
+
+static void summarize(Result* result) {
+    double sum = 0.0, squares = 0.0;
+
+    for (int i = 0; i < result->count; i++) {
+        sum += result->samples[i];
+    }
+    result->mean = result->count > 0 ? sum / result->count : 0.0;
+    for (int i = 0; i < result->count; i++) {
+        squares += (result->samples[i] - result->mean) * (result->samples[i] - result->mean);
+    }
+    result->variance = result->count > 1 ? squares / (result->count - 1) : 0.0;
+}
+
+static int load_results(const char* path, ResultSet* set) {
+    FILE* file = fopen(path, "rb");
+    JsonValue root;
+
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long bytes = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = malloc((size_t)bytes + 1);
+    text[fread(text, 1, (size_t)bytes, file)] = '\0';
+    fclose(file);
+
+    const char* end = parse_value(text, &root);
+    free(text);
+    const JsonValue* benchmark = end != NULL ? json_get(&root, "benchmark") : NULL;
+    const JsonValue* results = end != NULL ? json_get(&root, "results") : NULL;
+    if (benchmark == NULL || benchmark->type != JSON_STRING || results == NULL || results->type != JSON_ARRAY) {
+        fprintf(stderr, "%s: not a benchmark result file\n", path);
+        if (end != NULL) {
+            json_free(&root);
+        }
+        return -1;
+    }
+
+    set->schema = NULL;
+    for (size_t i = 0; i < sizeof(schemas) / sizeof(schemas[0]); i++) {
+        if (strcmp(schemas[i].benchmark, benchmark->string) == 0) {
+            set->schema = &schemas[i];
+        }
+    }
+    if (set->schema == NULL) {
+        fprintf(stderr, "%s: unknown benchmark \"%s\"\n", path, benchmark->string);
+        json_free(&root);
+        return -1;
+    }
+
+    set->results = calloc((size_t)results->count + 1, sizeof(Result));
+    set->count = 0;
+    for (int i = 0; i < results->count; i++) {
+        const JsonValue* entry = &results->items[i];
+        const JsonValue* samples = json_get(entry, set->schema->samples_field);
+        Result* result = &set->results[set->count];
+        size_t length = 0;
+
+        if (samples == NULL || samples->type != JSON_ARRAY) {
+            continue;
+        }
+        for (int k = 0; k < MAX_KEY_FIELDS && set->schema->key_fields[k] != NULL; k++) {
+            const JsonValue* field = json_get(entry, set->schema->key_fields[k]);
+            const char* separator = k > 0 ? " / " : "";
+
+            if (field != NULL && field->type == JSON_STRING) {
+                length += snprintf(result->name + length, sizeof(result->name) - length, "%s%s",
+                                   separator, field->string);
+            } else if (field != NULL) {
+                length += snprintf(result->name + length, sizeof(result->name) - length, "%s%.0f",
+                                   separator, field->number);
+            }
+            if (length >= sizeof(result->name)) {
+                length = sizeof(result->name) - 1;
+            }
+        }
+        for (int s = 0; s < samples->count && result->count < MAX_SAMPLES; s++) {
+            result->samples[result->count++] = samples->items[s].number;
+        }
+        summarize(result);
+        set->count++;
+    }
+    json_free(&root);
+    return 0;
+}
+
+static double t_critical(double degrees_of_freedom) {
+    int df = (int)degrees_of_freedom;
+
+    if (df < 1) {
+        df = 1;
+    }
+    if (df <= 30) {
+        return t_table[df - 1];
+    }
+    return df <= 40 ? 2.021 : df <= 60 ? 2.000 : df <= 120 ? 1.980 : 1.960;
+}
+
+// Slowdown of `current` against `base` in percent with its 95% interval.
+// Positive is slower whichever way the metric points. The interval comes
+// from Welch's t-test on the difference of means, relative to the baseline
+// mean. Without repetitions on both sides it collapses to the point value.
+static void compare(const BenchSchema* schema, const Result* base, const Result* current,
+                    double* change, double* low, double* high) {
+    double sign = schema->higher_is_better ? -1.0 : 1.0;
+    double difference = sign * (current->mean - base->mean);
+    double base_term = base->count > 0 ? base->variance / base->count : 0.0;
+    double current_term = current->count > 0 ? current->variance / current->count : 0.0;
+    double standard_error = sqrt(base_term + current_term);
+    double margin = 0.0;
+
+    if (base->count > 1 && current->count > 1 && standard_error > 0) {
+        double df = (base_term + current_term) * (base_term + current_term) /
+                    (base_term * base_term / (base->count - 1) + current_term * current_term / (current->count - 1));
+        margin = t_critical(df) * standard_error;
+    }
+    double scale = base->mean != 0 ? 100.0 / fabs(base->mean) : 0.0;
+    *change = difference * scale;
+    *low = (difference - margin) * scale;
+    *high = (difference + margin) * scale;
+}
+
+int main(int argc, char* argv[]) {
+    double threshold = DEFAULT_THRESHOLD_PCT;
+    const char* paths[2];
+    int path_count = 0;
+    ResultSet base, current;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (path_count < 2 && argv[i][0] != '-') {
+            paths[path_count++] = argv[i];
+        } else {
+            path_count = 0;
+            break;
+        }
+    }
+    if (path_count != 2) {
+        fprintf(stderr, "Usage: %s [--threshold PCT] BASELINE CURRENT\n", argv[0]);
+        return 2;
+    }
+    if (load_results(paths[0], &base) != 0 || load_results(paths[1], &current) != 0) {
+        return 2;
+    }
+    if (base.schema != current.schema) {
+        fprintf(stderr, "%s and %s come from different benchmarks\n", paths[0], paths[1]);
+        return 2;
+    }
+
+    const BenchSchema* schema = base.schema;
+    int counts[4] = {0}, missing = 0, added = 0;
+    printf("\n--- Performance Check: %s (%s, %s is better, threshold %.1f%%) ---\n", schema->benchmark,
+           schema->unit, schema->higher_is_better ? "higher" : "lower", threshold);
+    printf("+----------------------------------------------------------+--------------+--------------+----------+----------------------+-----------+\n");
+    printf("| Result                                                   | Baseline     | Current      | Slowdown | 95%% interval         | Verdict   |\n");
+    printf("+----------------------------------------------------------+--------------+--------------+----------+----------------------+-----------+\n");
+
+    for (int i = 0; i < current.count; i++) {
+        Result* now = &current.results[i];
+        Result* then = NULL;
+
+        for (int j = 0; j < base.count && then == NULL; j++) {
+            if (!base.results[j].matched && strcmp(base.results[j].name, now->name) == 0) {
+                then = &base.results[j];
+                then->matched = true;
+            }
+        }
+        if (then == NULL) {
+            printf("| %-56.56s | %12s | %12.1f | %8s | %20s | %-9s |\n", now->name, "-", now->mean, "-", "-", "new");
+            added++;
+            continue;
+        }
+
+        double change, low, high;
+        compare(schema, then, now, &change, &low, &high);
+        Verdict verdict = low > 0 ? (change > threshold ? VERDICT_REGRESSED : VERDICT_SLOWER)
+                        : high < 0 ? VERDICT_FASTER : VERDICT_SAME;
+        counts[verdict]++;
+        printf("| %-56.56s | %12.1f | %12.1f | %+7.1f%% | %+8.1f%% .. %+7.1f%% | %-9s |\n", now->name,
+               then->mean, now->mean, change, low, high, verdict_names[verdict]);
+    }
+    for (int j = 0; j < base.count; j++) {
+        if (!base.results[j].matched) {
+            printf("| %-56.56s | %12.1f | %12s | %8s | %20s | %-9s |\n", base.results[j].name,
+                   base.results[j].mean, "-", "-", "-", "missing");
+            missing++;
+        }
+    }
+    printf("+----------------------------------------------------------+--------------+--------------+----------+----------------------+-----------+\n");
+    printf("%d regressed, %d slower within threshold, %d faster, %d unchanged", counts[VERDICT_REGRESSED],
+           counts[VERDICT_SLOWER], counts[VERDICT_FASTER], counts[VERDICT_SAME]);
+    if (added > 0 || missing > 0) {
+        printf(", %d new, %d missing", added, missing);
+    }
+    printf("\n");
+
+    free(base.results);
+    free(current.results);
+    return counts[VERDICT_REGRESSED] > 0 ? 1 : 0;
+}
@@ -3,12 +3,80 @@
 #include <string.h>
 #include <time.h>
 #include <stdbool.h>
+#include <stdarg.h>
+#include <errno.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#if defined(OP_TIMING) && defined(OP_TIMING_TSC) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
 
-#define MAX_PROCESSES 1000
+#define MAX_PROCESSES 1000           // Largest generated sample; files may hold any number
 #define MAX_FILENAME_LENGTH 256
 #define TERMINAL_WIDTH 80
 #define BAR_LENGTH 50
+#define DEFAULT_RENDER_ROW_LIMIT 40  // Memory map rows shown before runs are collapsed
+#define FRAME_ROW_BYTES 256          // Worst-case bytes for one rendered row
+#define FRAME_FIXED_BYTES 4096       // Header and footer space in a frame
+#define EVENT_LOG_LINES 8            // Recent events kept on screen in differential mode
+#define EVENT_LINE_BYTES 160
+#define MAX_RENDER_FPS 120
+#define UTILIZATION_LEVELS 1000      // Utilization percentiles have 0.1% resolution
+#define FREE_SIZE_CLASSES 32         // Power-of-two classes in the free-size histogram
+#define FRAGMENTATION_LOG_FILE "fragmentation_metrics.csv"
+#define DEFAULT_COMPACTION_THRESHOLD 0.5   // Fragmentation index that triggers compaction
+#define DEFAULT_COMPACTION_PERIOD 10       // Time units between periodic compactions
+#define DEFAULT_COMPACTION_COPY_RATE 100   // MB copied per simulated time unit
+#define DEFAULT_COMPACTION_STEP_BUDGET 64  // MB the incremental compactor may move per time step
+#define DEFAULT_SWAP_MIN_RESIDENCY 5       // Time units a process runs before it may be swapped out
+#define DEFAULT_SWAP_IO_RATE 50            // MB written or read per simulated time unit
+#define DEFAULT_AGING_RATE 0.5             // Priority gained per time unit spent waiting
+#define BENCH_MEMORY_SIZE 1024             // MB of memory in headless benchmark runs
+#define BENCH_LOAD_FACTOR 0.7              // Offered memory load of generated benchmark traces
+#define BENCH_DEFAULT_MAX_JOBS 1000000
+#define BENCH_MAX_REPS 32
+#define BENCH_SWAP_WAIT 10                 // Swap wait threshold of the benchmark's swapping runs
+#define CHECK_MEMORY_SIZE 700              // MB of memory in the swapping regression check
+#define CHECK_JOBS 300                     // Processes per regression check trace
+#define CHECK_SEEDS 5                      // Random traces run under each queue policy
+
+// Per-operation latency instrumentation. Build with -DOP_TIMING to enable
+// (add -DOP_TIMING_TSC on x86 to count TSC cycles instead of nanoseconds).
+// Without OP_TIMING the timer macros expand to nothing.
+#ifdef OP_TIMING
+#define LATENCY_SUB_BUCKET_BITS 4    // 16 linear sub-buckets per power of two
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_BUCKET_COUNT ((64 - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS)
+#if defined(OP_TIMING_TSC) && (defined(__x86_64__) || defined(__i386__))
+#define OP_TIMING_UNIT "cycles"
+#else
+#define OP_TIMING_UNIT "ns"
+#endif
+#define OP_TIMER_START() unsigned long long op_started = op_timer_now()
+#define OP_TIMER_STOP(op) latency_record(&op_latency[op], op_timer_now() - op_started)
+#else
+#define OP_TIMER_START()
+#define OP_TIMER_STOP(op)
+#endif
+
+// Per-phase timing of the simulation loop. Build with -DPHASE_TIMING to
+// enable; each phase then gets a call count, total and maximum, and runs
+// can optionally be exported as Chrome trace events for chrome://tracing
+// or Perfetto. Without PHASE_TIMING the timer macros expand to nothing.
+#ifdef PHASE_TIMING
+#define PHASE_TRACE_FILE "phase_trace.json"
+#define PHASE_TRACE_MAX_EVENTS 4000000     // Events kept per run; later ones are dropped
+#define PHASE_TIMER_START(phase) unsigned long long phase##_started = phase_timer_now()
+#define PHASE_TIMER_STOP(phase) phase_record(phase, phase##_started, phase_timer_now())
+#else
+#define PHASE_TIMER_START(phase)
+#define PHASE_TIMER_STOP(phase)
+#endif
 
 // ANSI color codes for terminal output
 #define COLOR_RESET "\033[0m"
@@ -31,6 +99,7 @@ typedef struct MemoryBlock {
     int process_id;  // -1 for free blocks
     int arrival_time;
     int allocation_time;
+    struct Process* owner;  // NULL for free blocks
     struct MemoryBlock* next;
 } MemoryBlock;
 
@@ -46,6 +115,12 @@ typedef struct Process {
     int execution_time;     // Total time process needs to run
     int remaining_time;     // Time remaining until process completes
     bool completed;         // Whether the process has completed execution
+    int completion_time;    // When the process finished
+    int queued_time;        // When the process last entered the waiting queue
+    bool swapped_out;       // Evicted to backing store, waiting to be swapped back in
+    int swap_count;         // Times this process was swapped out
+    double queue_key;       // Waiting queue priority, lower goes first
+    int queue_order;        // Tie-breaker: order of entering the queue
 } Process;
 
 // Structure for tracking simulation statistics
@@ -60,44 +135,388 @@ typedef struct SimulationStats {
     int completed_processes;
     double avg_turnaround_time;  // Time from arrival to completion
     double avg_execution_time;   // Average actual execution time
+    double peak_memory_utilization;
+    double utilization_p50;      // Time-weighted utilization percentiles
+    double utilization_p95;
+    double utilization_p99;
+    double avg_fragmentation_index;  // Mean of the per-step fragmentation index
+    double peak_fragmentation_index;
+    int peak_free_blocks;
+    int compactions;
+    int compaction_mb_moved;     // Total size of allocated blocks that were copied
+    double compaction_cost;      // Simulated copy time for those moves
+    int compaction_allocations;  // Allocations that only succeeded after compacting
+    int compaction_moves;        // Blocks moved by the incremental compactor
+    int compaction_max_step_mb;  // Most MB moved by the incremental compactor in one step
+    int swap_outs;
+    int swap_ins;
+    int swap_mb_out;
+    int swap_mb_in;
+    int backfilled_processes;    // Started ahead of the queue head by backfilling
+    long long queue_operations;  // Waiting queue heap inserts and removals
 } SimulationStats;
 
+// Free-space metrics kept up to date at every split, allocation, free and
+// merge, so reading them never requires walking the block list
+typedef struct FragmentationMetrics {
+    int free_block_count;
+    int total_free;
+    int largest_free;
+    int* free_size_count;          // Free blocks of each exact size (index = MB)
+    int size_class_count[FREE_SIZE_CLASSES];  // Free blocks with size in [2^k, 2^(k+1))
+    int samples;                   // Time steps recorded this run
+    double index_sum;
+    FILE* log;                     // Per-step time series, NULL when not exporting
+} FragmentationMetrics;
+
+// Exact time-weighted record of memory use. It is only touched when an
+// allocation or free changes memory_used, never by walking the block list.
+typedef struct UtilizationTracker {
+    int last_change_time;        // Time memory_used last changed
+    double used_time;            // Integral of memory_used over time (MB x time units)
+    int peak_used;
+    double time_at_level[UTILIZATION_LEVELS + 1];  // Time spent at each utilization level
+} UtilizationTracker;
+
+// When the engine compacts memory
+typedef enum CompactionTrigger {
+    COMPACT_NEVER,
+    COMPACT_ON_FAILURE,     // An allocation failed although enough memory was free
+    COMPACT_ON_THRESHOLD,   // The fragmentation index reached compaction_threshold
+    COMPACT_PERIODIC,       // Every compaction_period time units
+    COMPACT_INCREMENTAL     // Move at most compaction_step_budget MB every time step
+} CompactionTrigger;
+
+// Order in which waiting processes are tried
+typedef enum QueuePolicy {
+    QUEUE_FCFS,            // Order of entering the queue
+    QUEUE_SJF,             // Shortest execution time first
+    QUEUE_SMALLEST_FIRST,  // Smallest memory size first
+    QUEUE_LARGEST_FIRST,   // Largest memory size first
+    QUEUE_AGING,           // Shortest job first, but waiting raises priority
+    QUEUE_POLICY_COUNT
+} QueuePolicy;
+
+// The reservation the waiting head holds under EASY backfilling: the time
+// it can start and the address range it gets then. A head that never fits
+// reserves nothing, so anything may start ahead of it.
+typedef struct Reservation {
+    const Process* head;
+    int time;           // INT_MAX when the head never fits
+    int start;          // Address range reserved for the head
+    int end;
+} Reservation;
+
+// Results of the runs made with one queue policy
+typedef struct PolicyStats {
+    int runs;
+    int completed;
+    long long total_waiting_time;
+    long long total_turnaround_time;
+    int max_waiting_time;
+    int p95_waiting_time;       // From the most recent run
+    long long total_time;       // Simulated time units over all runs
+    long long queue_operations; // Heap inserts and removals
+} PolicyStats;
+
+// How the simulation loop draws each time step
+typedef enum DisplayMode {
+    DISPLAY_FULL_REDRAW,   // Clear the screen and print everything again
+    DISPLAY_DIFFERENTIAL   // Rewrite only the screen rows that changed
+} DisplayMode;
+
+// Preallocated output buffer holding one rendered frame
+typedef struct FrameBuffer {
+    char* data;
+    size_t length;
+    size_t capacity;
+} FrameBuffer;
+
+// One memory block as seen by the renderer
+typedef struct SnapshotBlock {
+    int start_address;
+    int size;
+    bool is_free;
+    int process_id;
+    int remaining_time;
+} SnapshotBlock;
+
+// Immutable copy of everything a frame shows. The simulation fills one in
+// and hands it over; the renderer never looks at the live block list.
+typedef struct MemorySnapshot {
+    int time;
+    int total_memory_size;
+    int memory_used;
+    int block_count;
+    int free_block_count;
+    int largest_free_block;
+    int waiting_count;
+    SnapshotBlock* blocks;
+    int block_capacity;
+    Process* allocated;         // First rows of the allocated process table
+    int allocated_rows;
+    int allocated_count;        // Total allocated processes, including rows not copied
+    int allocated_capacity;
+    char events[EVENT_LOG_LINES][EVENT_LINE_BYTES];
+    int event_count;
+    bool finished;
+} MemorySnapshot;
+
+// What is currently on the terminal, one hash per screen row
+typedef struct ScreenState {
+    unsigned long* row_hash;
+    int row_count;
+    int row_capacity;
+    int terminal_rows;
+    bool valid;            // False until a full frame has been drawn
+} ScreenState;
+
+// One headless simulation run, measured in a child process so that its
+// peak RSS is its own
+typedef struct BenchResult {
+    long long events;       // Arrivals, allocations, completions, swap-outs and compactions
+    long long steps;        // Simulated time steps
+    double seconds;         // Wall time of the simulation loop
+    long peak_rss_kb;
+    bool finished;          // False if the run hit its time step bound
+} BenchResult;
+
+// How the benchmark schedules the waiting queue, on top of its policy
+typedef enum BenchScheduling {
+    BENCH_PLAIN,
+    BENCH_BACKFILL,         // EASY backfilling
+    BENCH_SWAP,             // Swapping after BENCH_SWAP_WAIT time units
+    BENCH_SCHEDULING_COUNT
+} BenchScheduling;
+
+#ifdef OP_TIMING
+// Operations with their own latency histogram
+typedef enum TimedOperation {
+    OP_ALLOCATE,
+    OP_DEALLOCATE,
+    OP_MERGE,
+    OP_COUNT
+} TimedOperation;
+
+// Log-linear latency histogram: each power of two is split into
+// LATENCY_SUB_BUCKETS equal buckets, so relative error stays under 1/16
+typedef struct LatencyHistogram {
+    unsigned long long count;
+    unsigned long long total;
+    unsigned long long min;
+    unsigned long long max;
+    unsigned long long buckets[LATENCY_BUCKET_COUNT];
+} LatencyHistogram;
+#endif
+
+#ifdef PHASE_TIMING
+// Phases of a simulation time step that are timed separately
+typedef enum SimulationPhase {
+    PHASE_ARRIVALS,
+    PHASE_COMPLETION,
+    PHASE_WAITING,
+    PHASE_UTILIZATION,
+    PHASE_RENDER,
+    PHASE_COUNT
+} SimulationPhase;
+
+typedef struct PhaseTotals {
+    unsigned long long count;
+    unsigned long long total_ns;
+    unsigned long long max_ns;
+} PhaseTotals;
+
+// One timed interval, kept for the trace export
+typedef struct PhaseEvent {
+    unsigned long long start_ns;    // Since the run started
+    unsigned long long duration_ns;
+    int phase;
+    int thread;
+} PhaseEvent;
+
+typedef struct PhaseTrace {
+    PhaseEvent* events;
+    int count;
+    int capacity;
+    long dropped;
+    unsigned long long origin_ns;
+} PhaseTrace;
+#endif
+
 // Global variables
 MemoryBlock* memory_head = NULL;
-Process processes[MAX_PROCESSES];
-Process* waiting_queue[MAX_PROCESSES];
+// The process table and the arrays indexed alongside it hold
+// process_capacity entries and grow through reserve_processes()
+Process* processes = NULL;
+int process_count = 0;
+int process_capacity = 0;
+Process** waiting_queue = NULL;   // Binary heap ordered by queue_policy
 int waiting_queue_size = 0;
-int allocated_processes[MAX_PROCESSES];
+Process** waiting_order = NULL;   // Scratch space for trying waiters in order
+Process** allocated_processes = NULL;
 int allocated_count = 0;
 int current_time = 0;
 int total_memory_size = 0;
 SimulationStats stats = {0};
 bool color_enabled = true;
+int memory_block_count = 0;   // Number of blocks in the memory list
+int memory_used = 0;          // Sum of allocated block sizes
+UtilizationTracker utilization = {0};
+FragmentationMetrics fragmentation = {0};
+bool fragmentation_log_enabled = false;   // Export the time series; toggled in the settings menu
+CompactionTrigger compaction_trigger = COMPACT_NEVER;
+double compaction_threshold = DEFAULT_COMPACTION_THRESHOLD;
+int compaction_period = DEFAULT_COMPACTION_PERIOD;
+int compaction_copy_rate = DEFAULT_COMPACTION_COPY_RATE;
+int compaction_step_budget = DEFAULT_COMPACTION_STEP_BUDGET;
+int swap_wait_threshold = 0;     // Waiting time that allows swapping others out, 0 = no swapping
+int swap_min_residency = DEFAULT_SWAP_MIN_RESIDENCY;
+int swap_io_rate = DEFAULT_SWAP_IO_RATE;
+bool backfilling_enabled = false;
+QueuePolicy queue_policy = QUEUE_FCFS;
+double aging_rate = DEFAULT_AGING_RATE;
+int queue_sequence = 0;
+PolicyStats policy_stats[QUEUE_POLICY_COUNT];
+const char* queue_policy_names[QUEUE_POLICY_COUNT] = {
+    "FCFS", "Shortest job first", "Smallest size first", "Largest size first", "Aging"
+};
+const char* bench_scheduling_names[BENCH_SCHEDULING_COUNT] = { "plain", "backfill", "swap" };
+#ifdef OP_TIMING
+LatencyHistogram op_latency[OP_COUNT];
+const char* op_names[OP_COUNT] = { "allocate_memory", "deallocate_memory", "merge_free_blocks" };
+#endif
+#ifdef PHASE_TIMING
+// Each phase is only ever timed by one thread at a time: rendering happens
+// either inline or on the render thread, never both, so the totals need
+// no lock. The trace is shared and has one.
+PhaseTotals phase_totals[PHASE_COUNT];
+const char* phase_names[PHASE_COUNT] = {
+    "admit_arrivals", "check_process_completion", "check_waiting_processes",
+    "calculate_memory_utilization", "render"
+};
+bool phase_trace_enabled = false;
+PhaseTrace phase_trace = {0};
+pthread_mutex_t phase_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+atomic_int phase_thread_count = 0;
+__thread int phase_thread = 0;       // Trace thread id, assigned on first use
+#endif
+FrameBuffer frame = {0};
+int render_row_limit = DEFAULT_RENDER_ROW_LIMIT;
+DisplayMode display_mode = DISPLAY_FULL_REDRAW;
+FrameBuffer screen_update = {0};
+ScreenState screen = {0};
+char event_log[EVENT_LOG_LINES][EVENT_LINE_BYTES];
+int event_log_next = 0;
+int event_log_count = 0;
+bool event_log_enabled = false;   // Events go to the ring instead of stdout
+bool quiet = false;               // Events are dropped (headless benchmark runs)
+int render_fps = 0;               // 0 renders inline after every time step
+MemorySnapshot live_snapshot = {0};
+
+// Snapshot hand-off between the simulation and render threads. The render
+// thread only reads snapshots[snapshot_front]; the simulation thread fills the
+// other slot and swaps under snapshot_lock when the renderer asks for a frame.
+// The renderer raises snapshot_requested (release) only once it has finished
+// drawing, and the simulation reads it with acquire, so the renderer's reads
+// of a slot happen before the simulation next overwrites it.
+MemorySnapshot snapshots[2] = {{0}};
+int snapshot_front = 0;
+unsigned long snapshot_sequence = 0;
+atomic_bool snapshot_requested = false;
+pthread_mutex_t snapshot_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t snapshot_wanted = PTHREAD_COND_INITIALIZER;
 
 // Function prototypes
+void reserve_processes(int count);
 void initialize_memory(int size);
-void display_memory_state();
 bool allocate_memory(Process* process);
+bool allocate_best_fit(Process* process, int reserved_start, int reserved_end);
+bool allocate_memory_outside(Process* process, int reserved_start, int reserved_end);
 void deallocate_memory(int pid);
 void merge_free_blocks();
+int compact_memory();
+void run_compaction(const char* reason);
+int slide_block_down(MemoryBlock* hole);
+MemoryBlock* find_compaction_window(int needed);
+void compact_incremental_step();
+void check_compaction_trigger();
+bool allocate_or_compact(Process* process);
+bool can_swap_out(const MemoryBlock* block);
+MemoryBlock* find_swap_window(int needed);
+void swap_out_process(Process* process);
+bool swap_for_waiting_head();
+const char* compaction_trigger_name(CompactionTrigger trigger);
 void check_waiting_processes();
+void waiting_queue_enqueue(Process* process);
+void waiting_queue_insert(Process* process);
+Process* waiting_queue_pop();
+int drain_waiting_queue(Process** order);
+void record_policy_run();
+void display_policy_stats();
+bool reserve_for_process(const Process* process, int* reserved_time, int* reserved_start);
+void reserve_for_head(const Process* head, Reservation* reservation);
+bool backfill_process(Process* process, const Reservation* reservation);
+int backfill_waiting_processes();
 void simulate_time_step();
-bool add_process(Process* process);
+bool add_process(Process* process, Reservation* reservation);
 Process* create_sample_processes(int num_processes);
-int read_processes_from_file(const char* filename, Process* processes);
+int read_processes_from_file(const char* filename);
 void save_processes_to_file(Process* processes, int count, const char* filename);
-void display_allocated_processes();
 void free_memory();
 void calculate_memory_utilization();
+void utilization_advance(int now);
+void fragmentation_reset(int size);
+void fragmentation_add_free(int size);
+void fragmentation_remove_free(int size);
+double fragmentation_index();
+void record_fragmentation_sample();
+void fragmentation_log_open(const char* filename);
+void fragmentation_log_close();
+double utilization_percentile(double fraction);
+#ifdef OP_TIMING
+unsigned long long op_timer_now();
+void latency_record(LatencyHistogram* histogram, unsigned long long value);
+unsigned long long latency_percentile(const LatencyHistogram* histogram, double fraction);
+void display_op_latency();
+#endif
+#ifdef PHASE_TIMING
+unsigned long long phase_timer_now();
+void phase_record(SimulationPhase phase, unsigned long long started, unsigned long long ended);
+void phase_timing_reset();
+void display_phase_timing();
+void phase_trace_write(const char* filename);
+#endif
 void display_simulation_stats();
 void check_process_completion();
 void print_separator(char symbol);
 void print_centered_text(const char* text);
 void print_progress_bar(double percentage, int width);
-void display_simulation_header();
 void display_welcome_screen();
 void clear_screen();
-Process* get_process_by_pid(int pid);
+void frame_reserve(FrameBuffer* fb, int row_limit);
+void frame_append(FrameBuffer* fb, const char* format, ...);
+void frame_separator(FrameBuffer* fb, char symbol);
+void frame_progress_bar(FrameBuffer* fb, double percentage, int width);
+void frame_flush(FrameBuffer* fb);
+void render_memory_state(FrameBuffer* fb, const MemorySnapshot* snap);
+void render_allocated_processes(FrameBuffer* fb, const MemorySnapshot* snap);
+void render_screen(FrameBuffer* fb, const MemorySnapshot* snap, bool step_prompt);
+void display_screen(const MemorySnapshot* snap, bool step_prompt);
+void display_screen_differential(const MemorySnapshot* snap, bool step_prompt);
+void reset_screen_state();
+void sim_log(const char* color, const char* format, ...);
+void capture_snapshot(MemorySnapshot* snap, bool finished);
+void publish_snapshot(bool finished);
+void free_snapshot(MemorySnapshot* snap);
+void admit_arrivals(int* next_process, int num_processes);
+void run_simulation_threaded(int num_processes);
+void* simulation_thread(void* arg);
+void* render_thread(void* arg);
+void configure_settings();
+void reset_simulation(int memory_size);
+int generate_benchmark_trace(int jobs);
+int run_benchmark(int argc, char* argv[]);
+int run_swap_check();
 
 // Clear the terminal screen
 void clear_screen() {
@@ -155,13 +574,319 @@ void display_welcome_screen() {
     printf("\n");
 }
 
-// Display simulation header
-void display_simulation_header() {
-    print_separator('=');
-    printf("%s%s", BOLD, COLOR_CYAN);
-    print_centered_text("MEMORY ALLOCATION SIMULATION");
-    printf("%s", COLOR_RESET);
-    print_separator('-');
+
+// Allocate a frame buffer large enough for the given memory map row limit.
+// Frames never grow past this, so rendering does no allocation per frame.
+void frame_reserve(FrameBuffer* fb, int row_limit) {
+    size_t rows = row_limit > 0 ? (size_t)row_limit : (size_t)DEFAULT_RENDER_ROW_LIMIT;
+    size_t capacity = FRAME_FIXED_BYTES + (rows + 2) * FRAME_ROW_BYTES;
+
+    if (fb->data != NULL && fb->capacity >= capacity) {
+        fb->length = 0;
+        return;
+    }
+
+    char* data = (char*)realloc(fb->data, capacity);
+    if (data == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    fb->data = data;
+    fb->capacity = capacity;
+    fb->length = 0;
+}
+
+// Append formatted text to the frame, truncating if the frame is full
+void frame_append(FrameBuffer* fb, const char* format, ...) {
+    if (fb->length + 1 >= fb->capacity) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(fb->data + fb->length, fb->capacity - fb->length, format, args);
+    va_end(args);
+
+    if (written < 0) {
+        return;
+    }
+    if ((size_t)written >= fb->capacity - fb->length) {
+        fb->length = fb->capacity - 1;
+    } else {
+        fb->length += written;
+    }
+}
+
+// Append a separator line to the frame
+void frame_separator(FrameBuffer* fb, char symbol) {
+    char line[TERMINAL_WIDTH + 1];
+    memset(line, symbol, TERMINAL_WIDTH);
+    line[TERMINAL_WIDTH] = '\0';
+    frame_append(fb, "%s%s%s\n", COLOR_BRIGHT_BLACK, line, COLOR_RESET);
+}
+
+// Append a progress bar to the frame
+void frame_progress_bar(FrameBuffer* fb, double percentage, int width) {
+    int i;
+    int pos = width * percentage;
+
+    frame_append(fb, "[%s", COLOR_GREEN);
+    for (i = 0; i < width && i < pos; i++) {
+        frame_append(fb, "█");
+    }
+    frame_append(fb, "%s", COLOR_RESET);
+    for (; i < width; i++) {
+        frame_append(fb, " ");
+    }
+    frame_append(fb, "] %s%.1f%%%s", COLOR_YELLOW, percentage * 100, COLOR_RESET);
+}
+
+// Write the whole frame to the terminal with a single write() call
+void frame_flush(FrameBuffer* fb) {
+    size_t offset = 0;
+
+    // Anything still sitting in stdio must come out before the frame
+    fflush(stdout);
+
+    while (offset < fb->length) {
+        ssize_t written = write(STDOUT_FILENO, fb->data + offset, fb->length - offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        offset += written;
+    }
+    fb->length = 0;
+}
+
+// Report a simulation event. When the renderer owns the screen, events are
+// kept in a small ring shown at the bottom of it instead of scrolling it.
+void sim_log(const char* color, const char* format, ...) {
+    char message[EVENT_LINE_BYTES];
+    va_list args;
+    if (quiet) {
+        return;
+    }
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    if (!event_log_enabled) {
+        printf("%s%s%s\n", color, message, COLOR_RESET);
+        return;
+    }
+
+    // Keep the line within the terminal width so screen rows stay aligned
+    snprintf(event_log[event_log_next], EVENT_LINE_BYTES, "%s%.*s%s",
+             color, TERMINAL_WIDTH, message, COLOR_RESET);
+    event_log_next = (event_log_next + 1) % EVENT_LOG_LINES;
+    if (event_log_count < EVENT_LOG_LINES) {
+        event_log_count++;
+    }
+}
+
+// Render a whole simulation screen: header, memory map, allocated
+// processes and the most recent events
+void render_screen(FrameBuffer* fb, const MemorySnapshot* snap, bool step_prompt) {
+    char line[TERMINAL_WIDTH + 1];
+    int padding = (TERMINAL_WIDTH - (int)strlen("MEMORY ALLOCATION SIMULATION")) / 2;
+
+    frame_separator(fb, '=');
+    snprintf(line, sizeof(line), "%*s%s", padding, "", "MEMORY ALLOCATION SIMULATION");
+    frame_append(fb, "%s%s%s%s\n", BOLD, COLOR_CYAN, line, COLOR_RESET);
+    frame_separator(fb, '-');
+
+    render_memory_state(fb, snap);
+    render_allocated_processes(fb, snap);
+
+    frame_append(fb, "\n%sRecent events:%s\n", BOLD, COLOR_RESET);
+    for (int i = 0; i < snap->event_count; i++) {
+        frame_append(fb, "%s\n", snap->events[i]);
+    }
+
+    if (step_prompt) {
+        frame_append(fb, "Press ENTER to continue...");
+    }
+}
+
+// Number of rows a frame for this snapshot may need
+static int snapshot_rows(const MemorySnapshot* snap) {
+    int rows = render_row_limit > 0 ? render_row_limit : snap->block_count;
+    return rows + snap->allocated_rows + EVENT_LOG_LINES;
+}
+
+// Draw the simulation screen in full, clearing whatever was there before
+void display_screen(const MemorySnapshot* snap, bool step_prompt) {
+    frame_reserve(&frame, snapshot_rows(snap));
+    frame_append(&frame, "\033[H\033[2J");
+    render_screen(&frame, snap, step_prompt);
+    frame_flush(&frame);
+}
+
+// Forget what is on the terminal so the next differential frame is drawn in full
+void reset_screen_state() {
+    screen.row_count = 0;
+    screen.valid = false;
+    event_log_next = 0;
+    event_log_count = 0;
+}
+
+// FNV-1a hash of one screen row
+static unsigned long hash_row(const char* row, size_t length) {
+    unsigned long hash = 2166136261UL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)row[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+// Draw the simulation screen by rewriting only the rows whose contents
+// changed since the previous frame, using cursor addressing. A tick that
+// touches one block costs a few rows of output instead of a full redraw.
+void display_screen_differential(const MemorySnapshot* snap, bool step_prompt) {
+    int rows = snapshot_rows(snap);
+    frame_reserve(&frame, rows);
+    render_screen(&frame, snap, step_prompt);
+
+    // Rows that do not fit on the terminal are never drawn; a resize forces
+    // a full redraw since everything on screen may have moved
+    int terminal_rows = 0;
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0) {
+        terminal_rows = size.ws_row;
+    }
+    if (terminal_rows != screen.terminal_rows) {
+        screen.terminal_rows = terminal_rows;
+        screen.valid = false;
+    }
+
+    frame_reserve(&screen_update, 2 * rows);
+    if (!screen.valid) {
+        frame_append(&screen_update, "\033[?25l\033[H\033[2J");
+        screen.row_count = 0;
+    }
+
+    int row = 0;
+    size_t offset = 0;
+    while (offset < frame.length && (terminal_rows == 0 || row < terminal_rows)) {
+        char* start = frame.data + offset;
+        char* newline = memchr(start, '\n', frame.length - offset);
+        size_t length = newline ? (size_t)(newline - start) : frame.length - offset;
+
+        if (row >= screen.row_capacity) {
+            int capacity = screen.row_capacity ? screen.row_capacity * 2 : 128;
+            unsigned long* hashes = (unsigned long*)realloc(screen.row_hash, capacity * sizeof(unsigned long));
+            if (hashes == NULL) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(1);
+            }
+            screen.row_hash = hashes;
+            screen.row_capacity = capacity;
+        }
+
+        unsigned long hash = hash_row(start, length);
+        if (row >= screen.row_count || screen.row_hash[row] != hash) {
+            frame_append(&screen_update, "\033[%d;1H%.*s\033[K", row + 1, (int)length, start);
+            screen.row_hash[row] = hash;
+        }
+
+        row++;
+        offset += length + (newline ? 1 : 0);
+    }
+
+    // Clear rows left over from a longer previous frame
+    if (row < screen.row_count) {
+        frame_append(&screen_update, "\033[%d;1H\033[J", row + 1);
+    }
+    screen.row_count = row;
+    screen.valid = true;
+
+    frame_flush(&screen_update);
+    frame.length = 0;
+}
+
+// Copy the simulation state a frame needs into a snapshot. Runs on the
+// simulation side; the arrays are reused from one capture to the next.
+void capture_snapshot(MemorySnapshot* snap, bool finished) {
+    if (snap->block_capacity < memory_block_count) {
+        int capacity = memory_block_count * 2;
+        SnapshotBlock* blocks = (SnapshotBlock*)realloc(snap->blocks, capacity * sizeof(SnapshotBlock));
+        if (blocks == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        snap->blocks = blocks;
+        snap->block_capacity = capacity;
+    }
+
+    snap->time = current_time;
+    snap->total_memory_size = total_memory_size;
+    snap->memory_used = memory_used;
+    snap->waiting_count = waiting_queue_size;
+    snap->finished = finished;
+    snap->free_block_count = fragmentation.free_block_count;
+    snap->largest_free_block = fragmentation.largest_free;
+
+    int count = 0;
+    MemoryBlock* current = memory_head;
+    while (current != NULL) {
+        SnapshotBlock* block = &snap->blocks[count++];
+        block->start_address = current->start_address;
+        block->size = current->size;
+        block->is_free = current->is_free;
+        block->process_id = current->process_id;
+        block->remaining_time = current->owner ? current->owner->remaining_time : 0;
+        current = current->next;
+    }
+    snap->block_count = count;
+
+    // Only the rows the process table can show are copied
+    int rows = allocated_count;
+    if (render_row_limit > 0 && rows > render_row_limit) {
+        rows = render_row_limit;
+    }
+    if (snap->allocated_capacity < rows) {
+        Process* allocated = (Process*)realloc(snap->allocated, rows * sizeof(Process));
+        if (allocated == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        snap->allocated = allocated;
+        snap->allocated_capacity = rows;
+    }
+    snap->allocated_rows = 0;
+    for (int i = 0; i < rows; i++) {
+        if (allocated_processes[i]->allocated) {
+            snap->allocated[snap->allocated_rows++] = *allocated_processes[i];
+        }
+    }
+    snap->allocated_count = allocated_count;
+
+    int first = (event_log_next - event_log_count + EVENT_LOG_LINES) % EVENT_LOG_LINES;
+    for (int i = 0; i < event_log_count; i++) {
+        memcpy(snap->events[i], event_log[(first + i) % EVENT_LOG_LINES], EVENT_LINE_BYTES);
+    }
+    snap->event_count = event_log_count;
+}
+
+// Fill the back snapshot and make it the one the render thread sees next
+void publish_snapshot(bool finished) {
+    int back = 1 - snapshot_front;
+    capture_snapshot(&snapshots[back], finished);
+
+    pthread_mutex_lock(&snapshot_lock);
+    snapshot_front = back;
+    snapshot_sequence++;
+    atomic_store_explicit(&snapshot_requested, false, memory_order_relaxed);
+    pthread_mutex_unlock(&snapshot_lock);
+}
+
+// Release the arrays held by a snapshot
+void free_snapshot(MemorySnapshot* snap) {
+    free(snap->blocks);
+    free(snap->allocated);
+    memset(snap, 0, sizeof(*snap));
 }
 
 // Initialize memory with a single free block
@@ -181,128 +906,229 @@ void initialize_memory(int size) {
     memory_head->process_id = -1;
     memory_head->arrival_time = -1;
     memory_head->allocation_time = -1;
+    memory_head->owner = NULL;
     memory_head->next = NULL;
+
+    memory_block_count = 1;
+    memory_used = 0;
+    fragmentation_reset(size);
+    fragmentation_add_free(size);
+
+    memset(&utilization, 0, sizeof(utilization));
+    utilization.last_change_time = current_time;
 }
 
-// Helper function to get process by pid
-Process* get_process_by_pid(int pid) {
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        if (processes[i].pid == pid) {
-            return &processes[i];
-        }
+// Make room for `count` processes in the process table and in the arrays
+// that point into it. Only call this between runs: growing moves the table.
+void reserve_processes(int count) {
+    if (count <= process_capacity) {
+        return;
     }
-    return NULL;
+    int capacity = process_capacity > 0 ? process_capacity : MAX_PROCESSES;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    Process* table = (Process*)realloc(processes, capacity * sizeof(Process));
+    Process** queue = (Process**)realloc(waiting_queue, capacity * sizeof(Process*));
+    Process** order = (Process**)realloc(waiting_order, capacity * sizeof(Process*));
+    Process** allocated = (Process**)realloc(allocated_processes, capacity * sizeof(Process*));
+    if (table == NULL || queue == NULL || order == NULL || allocated == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    memset(table + process_capacity, 0, (capacity - process_capacity) * sizeof(Process));
+    processes = table;
+    waiting_queue = queue;
+    waiting_order = order;
+    allocated_processes = allocated;
+    process_capacity = capacity;
 }
 
-// Display the current state of memory
-void display_memory_state() {
-    printf("\n%s%s==== MEMORY STATE (Time: %d) ====%s\n", BOLD, COLOR_CYAN, current_time, COLOR_RESET);
-    
-    // Calculate total free and used memory
-    int total_free = 0;
-    int total_used = 0;
-    MemoryBlock* current = memory_head;
-    
-    while (current != NULL) {
-        if (current->is_free) {
-            total_free += current->size;
-        } else {
-            total_used += current->size;
-        }
-        current = current->next;
+// Render the memory state into a frame in a single pass over the blocks.
+// Once there are more blocks than render_row_limit, consecutive blocks are
+// collapsed so that each row summarizes a run of blocks.
+void render_memory_state(FrameBuffer* fb, const MemorySnapshot* snap) {
+    frame_append(fb, "\n%s%s==== MEMORY STATE (Time: %d) ====%s\n", BOLD, COLOR_CYAN, snap->time, COLOR_RESET);
+
+    int total_used = snap->memory_used;
+    int total_free = snap->total_memory_size - snap->memory_used;
+    double used_percentage = (double)total_used / snap->total_memory_size;
+
+    frame_append(fb, "\n%sTotal Memory:%s %d MB\n", COLOR_WHITE, COLOR_RESET, snap->total_memory_size);
+    frame_append(fb, "%sUsed Memory:%s %d MB (", COLOR_WHITE, COLOR_RESET, total_used);
+    frame_progress_bar(fb, used_percentage, 20);
+    frame_append(fb, ")\n");
+    frame_append(fb, "%sFree Memory:%s %d MB (%.2f%%)\n", COLOR_WHITE, COLOR_RESET, total_free, (float)total_free / snap->total_memory_size * 100);
+
+    frame_append(fb, "\n%sMemory Blocks:%s\n", BOLD, COLOR_RESET);
+
+    // Number of consecutive blocks summarized by one row
+    int run_length = 1;
+    if (render_row_limit > 0 && snap->block_count > render_row_limit) {
+        run_length = (snap->block_count + render_row_limit - 1) / render_row_limit;
     }
-    
-    double used_percentage = (double)total_used / total_memory_size;
-    
-    printf("\n%sTotal Memory:%s %d MB\n", COLOR_WHITE, COLOR_RESET, total_memory_size);
-    printf("%sUsed Memory:%s %d MB (", COLOR_WHITE, COLOR_RESET, total_used);
-    print_progress_bar(used_percentage, 20);
-    printf(")\n");
-    printf("%sFree Memory:%s %d MB (%.2f%%)\n", COLOR_WHITE, COLOR_RESET, total_free, (float)total_free / total_memory_size * 100);
-    
-    printf("\n%sMemory Blocks:%s\n", BOLD, COLOR_RESET);
-    
-    // Display each memory block as a visualization
-    current = memory_head;
-    int block_count = 0;
-    while (current != NULL) {
-        block_count++;
-        
-        // Display block with different colors based on state
-        if (current->is_free) {
-            printf("%s[%5d - %5d]%s %s(%4d MB)%s %sFREE%s\n", 
-                  COLOR_BRIGHT_BLACK, current->start_address, 
-                  current->start_address + current->size - 1, COLOR_RESET,
-                  COLOR_BRIGHT_BLACK, current->size, COLOR_RESET,
-                  COLOR_GREEN, COLOR_RESET);
-        } else {
-            Process* proc = get_process_by_pid(current->process_id);
-            printf("%s[%5d - %5d]%s %s(%4d MB)%s %sP%-3d%s %s(remaining: %d)%s\n", 
-                  COLOR_YELLOW, current->start_address, 
-                  current->start_address + current->size - 1, COLOR_RESET,
-                  COLOR_YELLOW, current->size, COLOR_RESET,
-                  COLOR_RED, current->process_id, COLOR_RESET,
-                  COLOR_BLUE, proc ? proc->remaining_time : 0, COLOR_RESET);
+
+    // Current run being collapsed into a summary row
+    int run_blocks = 0;
+    int run_start = 0;
+    int run_free_blocks = 0;
+    int run_used = 0;
+    int run_largest_free = 0;
+
+    for (int i = 0; i < snap->block_count; i++) {
+        const SnapshotBlock* current = &snap->blocks[i];
+
+        if (run_length == 1) {
+            // Display block with different colors based on state
+            if (current->is_free) {
+                frame_append(fb, "%s[%5d - %5d]%s %s(%4d MB)%s %sFREE%s\n",
+                      COLOR_BRIGHT_BLACK, current->start_address,
+                      current->start_address + current->size - 1, COLOR_RESET,
+                      COLOR_BRIGHT_BLACK, current->size, COLOR_RESET,
+                      COLOR_GREEN, COLOR_RESET);
+            } else {
+                frame_append(fb, "%s[%5d - %5d]%s %s(%4d MB)%s %sP%-3d%s %s(remaining: %d)%s\n",
+                      COLOR_YELLOW, current->start_address,
+                      current->start_address + current->size - 1, COLOR_RESET,
+                      COLOR_YELLOW, current->size, COLOR_RESET,
+                      COLOR_RED, current->process_id, COLOR_RESET,
+                      COLOR_BLUE, current->remaining_time, COLOR_RESET);
+            }
+            continue;
         }
-        
-        current = current->next;
-    }
-    
-    // Display external fragmentation
-    int free_block_count = 0;
-    int largest_free_block = 0;
-    
-    current = memory_head;
-    while (current != NULL) {
+
+        if (run_blocks == 0) {
+            run_start = current->start_address;
+            run_free_blocks = 0;
+            run_used = 0;
+            run_largest_free = 0;
+        }
+        run_blocks++;
         if (current->is_free) {
-            free_block_count++;
-            if (current->size > largest_free_block) {
-                largest_free_block = current->size;
+            run_free_blocks++;
+            if (current->size > run_largest_free) {
+                run_largest_free = current->size;
             }
+        } else {
+            run_used += current->size;
+        }
+
+        if (run_blocks == run_length || i == snap->block_count - 1) {
+            int run_end = current->start_address + current->size;
+            frame_append(fb, "%s[%5d - %5d]%s %s(%4d MB)%s %s%d blocks:%s %d used (%d MB), %d free (largest %d MB)\n",
+                  COLOR_MAGENTA, run_start, run_end - 1, COLOR_RESET,
+                  COLOR_MAGENTA, run_end - run_start, COLOR_RESET,
+                  COLOR_CYAN, run_blocks, COLOR_RESET,
+                  run_blocks - run_free_blocks, run_used,
+                  run_free_blocks, run_largest_free);
+            run_blocks = 0;
         }
-        current = current->next;
     }
-    
-    if (free_block_count > 1) {
-        stats.total_fragmentation_events++;
-        printf("\n%sExternal Fragmentation:%s %d free blocks\n", COLOR_MAGENTA, COLOR_RESET, free_block_count);
-        printf("%sLargest free block:%s %d MB\n", COLOR_MAGENTA, COLOR_RESET, largest_free_block);
+
+    if (run_length > 1) {
+        frame_append(fb, "%s(%d blocks collapsed into runs of %d)%s\n",
+              COLOR_BRIGHT_BLACK, snap->block_count, run_length, COLOR_RESET);
     }
-    
-    print_separator('-');
+
+    // Display external fragmentation
+    if (snap->free_block_count > 1) {
+        frame_append(fb, "\n%sExternal Fragmentation:%s %d free blocks\n", COLOR_MAGENTA, COLOR_RESET, snap->free_block_count);
+        frame_append(fb, "%sLargest free block:%s %d MB\n", COLOR_MAGENTA, COLOR_RESET, snap->largest_free_block);
+    }
+
+    frame_separator(fb, '-');
 }
 
-// Best-fit algorithm for memory allocation
+// Allocate memory for a process, timing the call when OP_TIMING is enabled
 bool allocate_memory(Process* process) {
+    OP_TIMER_START();
+    bool allocated = allocate_best_fit(process, 0, 0);
+    OP_TIMER_STOP(OP_ALLOCATE);
+    return allocated;
+}
+
+// Allocate memory for a process without touching the reserved address
+// range [reserved_start, reserved_end)
+bool allocate_memory_outside(Process* process, int reserved_start, int reserved_end) {
+    OP_TIMER_START();
+    bool allocated = allocate_best_fit(process, reserved_start, reserved_end);
+    OP_TIMER_STOP(OP_ALLOCATE);
+    return allocated;
+}
+
+// Best-fit algorithm for memory allocation. A process normally goes at the
+// start of the smallest free block that holds it. When a reserved range is
+// given, placements overlapping it are skipped, and a block that the range
+// only partly covers can still be used above the range.
+bool allocate_best_fit(Process* process, int reserved_start, int reserved_end) {
     MemoryBlock* best_fit = NULL;
+    int best_offset = 0;
+    int best_span = 0;
     MemoryBlock* current = memory_head;
-    MemoryBlock* prev_best = NULL;
-    MemoryBlock* prev = NULL;
     
     // Find the smallest free block that can accommodate the process
     while (current != NULL) {
         if (current->is_free && current->size >= process->size) {
-            if (best_fit == NULL || current->size < best_fit->size) {
+            int block_end = current->start_address + current->size;
+            int taken = current->size <= process->size + 3 ? current->size : process->size;
+            int offset = -1;
+            int span = current->size;
+
+            if (current->start_address + taken <= reserved_start || current->start_address >= reserved_end) {
+                offset = 0;
+            } else if (reserved_end > current->start_address && block_end - reserved_end >= process->size) {
+                offset = reserved_end - current->start_address;
+                span = block_end - reserved_end;
+            }
+
+            if (offset >= 0 && (best_fit == NULL || span < best_span)) {
                 best_fit = current;
-                prev_best = prev;
+                best_offset = offset;
+                best_span = span;
             }
         }
-        prev = current;
         current = current->next;
     }
     
     // If no suitable block found
     if (best_fit == NULL) {
         stats.failed_allocations++;
+        // Enough memory is free, just not in one piece
+        if (fragmentation.total_free >= process->size) {
+            stats.total_fragmentation_events++;
+        }
         return false;
     }
+
+    if (best_offset > 0) {
+        // Leave the part below the placement as a free block of its own
+        MemoryBlock* rest = (MemoryBlock*)malloc(sizeof(MemoryBlock));
+        if (rest == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            return false;
+        }
+        *rest = *best_fit;
+        rest->start_address = best_fit->start_address + best_offset;
+        rest->size = best_fit->size - best_offset;
+        best_fit->size = best_offset;
+        best_fit->next = rest;
+        memory_block_count++;
+
+        fragmentation_remove_free(best_offset + rest->size);
+        fragmentation_add_free(best_offset);
+        fragmentation_add_free(rest->size);
+        best_fit = rest;
+    }
     
     // If the block is exactly the size needed or slightly larger
     if (best_fit->size <= process->size + 3) { // Small threshold to avoid tiny fragments
+        fragmentation_remove_free(best_fit->size);
         best_fit->is_free = false;
         best_fit->process_id = process->pid;
         best_fit->arrival_time = process->arrival_time;
         best_fit->allocation_time = current_time;
+        best_fit->owner = process;
     } else {
         // Split the block: create a new block for the remaining space
         MemoryBlock* new_block = (MemoryBlock*)malloc(sizeof(MemoryBlock));
@@ -310,6 +1136,7 @@ bool allocate_memory(Process* process) {
             fprintf(stderr, "Memory allocation failed\n");
             return false;
         }
+        fragmentation_remove_free(best_fit->size);
         
         new_block->start_address = best_fit->start_address + process->size;
         new_block->size = best_fit->size - process->size;
@@ -317,7 +1144,10 @@ bool allocate_memory(Process* process) {
         new_block->process_id = -1;
         new_block->arrival_time = -1;
         new_block->allocation_time = -1;
+        new_block->owner = NULL;
         new_block->next = best_fit->next;
+        memory_block_count++;
+        fragmentation_add_free(new_block->size);
         
         // Update the allocated block
         best_fit->size = process->size;
@@ -325,23 +1155,38 @@ bool allocate_memory(Process* process) {
         best_fit->process_id = process->pid;
         best_fit->arrival_time = process->arrival_time;
         best_fit->allocation_time = current_time;
+        best_fit->owner = process;
         best_fit->next = new_block;
     }
+    utilization_advance(current_time);
+    memory_used += best_fit->size;
+    if (memory_used > utilization.peak_used) {
+        utilization.peak_used = memory_used;
+    }
     
     // Update process information
     process->allocated = true;
     process->allocation_time = current_time;
     process->memory_address = best_fit->start_address;
-    process->remaining_time = process->execution_time;
     
-    // Calculate waiting time
-    process->waiting_time = current_time - process->arrival_time;
+    if (process->swapped_out) {
+        // Swapped back in: it keeps its remaining time, and the time spent
+        // on backing store counts as waiting
+        process->swapped_out = false;
+        process->waiting_time += current_time - process->queued_time;
+        stats.swap_ins++;
+        stats.swap_mb_in += process->size;
+    } else {
+        process->remaining_time = process->execution_time;
+        // Calculate waiting time
+        process->waiting_time = current_time - process->arrival_time;
+    }
     if (process->waiting_time > stats.max_waiting_time) {
         stats.max_waiting_time = process->waiting_time;
     }
     
     // Add to allocated processes
-    allocated_processes[allocated_count++] = process->pid;
+    allocated_processes[allocated_count++] = process;
     stats.successful_allocations++;
     
     return true;
@@ -349,16 +1194,23 @@ bool allocate_memory(Process* process) {
 
 // Deallocate memory for a process and merge adjacent free blocks
 void deallocate_memory(int pid) {
+    OP_TIMER_START();
     MemoryBlock* current = memory_head;
+    Process* proc = NULL;
     int found = 0;
     
     // Find the block allocated to this process
     while (current != NULL) {
         if (!current->is_free && current->process_id == pid) {
             // Free this block
+            proc = current->owner;
             current->is_free = true;
             current->process_id = -1;
             current->allocation_time = -1;
+            current->owner = NULL;
+            utilization_advance(current_time);
+            memory_used -= current->size;
+            fragmentation_add_free(current->size);
             found = 1;
             break;
         }
@@ -369,160 +1221,1113 @@ void deallocate_memory(int pid) {
         // Remove from allocated processes
         int i;
         for (i = 0; i < allocated_count; i++) {
-            if (allocated_processes[i] == pid) {
+            if (allocated_processes[i]->pid == pid) {
                 // Remove by shifting remaining elements
                 memmove(&allocated_processes[i], &allocated_processes[i + 1], 
-                        (allocated_count - i - 1) * sizeof(int));
+                        (allocated_count - i - 1) * sizeof(Process*));
                 allocated_count--;
                 break;
             }
         }
         
         // Mark the process as completed if it's not already marked
-        Process* proc = get_process_by_pid(pid);
         if (proc != NULL && !proc->completed && proc->remaining_time <= 0) {
             proc->completed = true;
+            proc->completion_time = current_time;
             stats.completed_processes++;
-            printf("%sProcess %d completed execution and deallocated at time %d%s\n", 
-                   COLOR_GREEN, pid, current_time, COLOR_RESET);
+            sim_log(COLOR_GREEN, "Process %d completed execution and deallocated at time %d", pid, current_time);
         }
         
         // Merge adjacent free blocks
         merge_free_blocks();
     } else {
-        printf("%sProcess %d not found in allocated processes.%s\n", COLOR_RED, pid, COLOR_RESET);
+        sim_log(COLOR_RED, "Process %d not found in allocated processes.", pid);
     }
+    OP_TIMER_STOP(OP_DEALLOCATE);
 }
 
 // Merge adjacent free blocks to reduce external fragmentation
 void merge_free_blocks() {
+    OP_TIMER_START();
     MemoryBlock* current = memory_head;
     
     while (current != NULL && current->next != NULL) {
         if (current->is_free && current->next->is_free) {
             // Merge blocks
             MemoryBlock* to_delete = current->next;
+            fragmentation_remove_free(current->size);
+            fragmentation_remove_free(to_delete->size);
+            fragmentation_add_free(current->size + to_delete->size);
             current->size += to_delete->size;
             current->next = to_delete->next;
             free(to_delete);
+            memory_block_count--;
             // Don't advance current since we need to check if the newly merged block
             // can be merged with the next one too
         } else {
             current = current->next;
         }
     }
+    OP_TIMER_STOP(OP_MERGE);
 }
 
-// Check if any waiting processes can now be allocated
-void check_waiting_processes() {
-    if (waiting_queue_size == 0) {
-        return;
-    }
-    
-    int allocated_from_queue = 0;
-    int i, j;
-    
-    for (i = 0; i < waiting_queue_size; i++) {
-        if (allocate_memory(waiting_queue[i])) {
-            printf("%sProcess %d allocated from waiting queue (time: %d)%s\n", 
-                   COLOR_GREEN, waiting_queue[i]->pid, current_time, COLOR_RESET);
-            allocated_from_queue++;
-            
-            // Remove from waiting queue by shifting remaining elements
-            for (j = i; j < waiting_queue_size - 1; j++) {
-                waiting_queue[j] = waiting_queue[j + 1];
+// Slide every allocated block down toward address 0, in address order, and
+// gather all free memory into one block at the top. Returns the MB copied.
+int compact_memory() {
+    MemoryBlock* current = memory_head;
+    MemoryBlock* prev = NULL;
+    int next_address = 0;
+    int moved = 0;
+
+    while (current != NULL) {
+        MemoryBlock* next = current->next;
+
+        if (current->is_free) {
+            // Drop the hole; its space reappears in the block at the top
+            fragmentation_remove_free(current->size);
+            if (prev == NULL) {
+                memory_head = next;
+            } else {
+                prev->next = next;
             }
-            waiting_queue_size--;
-            i--; // Adjust i since we removed an element
-        }
-    }
-    
-    if (allocated_from_queue > 0) {
-        printf("%sAllocated %d processes from waiting queue%s\n", COLOR_GREEN, allocated_from_queue, COLOR_RESET);
-        if (waiting_queue_size > 0) {
-            printf("%s%d processes still waiting%s\n", COLOR_YELLOW, waiting_queue_size, COLOR_RESET);
+            free(current);
+            memory_block_count--;
+        } else {
+            if (current->start_address != next_address) {
+                moved += current->size;
+                current->start_address = next_address;
+                if (current->owner != NULL) {
+                    current->owner->memory_address = next_address;
+                }
+            }
+            next_address += current->size;
+            prev = current;
         }
+        current = next;
     }
-}
 
-// Check for process completion and deallocate finished processes
-void check_process_completion() {
-    int i = 0;
-    while (i < allocated_count) {
-        int pid = allocated_processes[i];
-        Process* proc = get_process_by_pid(pid);
-        
-        if (proc != NULL && !proc->completed) {
-            // Decrement remaining time for the process
-            proc->remaining_time--;
-            
-            // Check if process has completed
-            if (proc->remaining_time <= 0) {
-                printf("%sProcess %d has finished execution at time %d%s\n", 
-                       COLOR_GREEN, pid, current_time, COLOR_RESET);
-                deallocate_memory(pid);
-                // Don't increment i since the array has shifted
-            } else {
-                i++; // Move to next process
-            }
+    if (next_address < total_memory_size) {
+        MemoryBlock* hole = (MemoryBlock*)malloc(sizeof(MemoryBlock));
+        if (hole == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        hole->start_address = next_address;
+        hole->size = total_memory_size - next_address;
+        hole->is_free = true;
+        hole->process_id = -1;
+        hole->arrival_time = -1;
+        hole->allocation_time = -1;
+        hole->owner = NULL;
+        hole->next = NULL;
+        if (prev == NULL) {
+            memory_head = hole;
         } else {
-            i++; // Move to next process
+            prev->next = hole;
         }
+        memory_block_count++;
+        fragmentation_add_free(hole->size);
     }
+
+    return moved;
 }
 
-// Calculate current memory utilization
-void calculate_memory_utilization() {
-    int total_used = 0;
-    MemoryBlock* current = memory_head;
+// Move the allocated block right after a hole down into it. The hole ends up
+// after the block, where it merges with the next hole if there is one.
+// The block list is fully consistent after every call. Returns the MB moved.
+int slide_block_down(MemoryBlock* hole) {
+    MemoryBlock* block = hole->next;
+    int hole_size = hole->size;
+
+    // The hole's node takes over the block, the block's node becomes the hole
+    hole->is_free = false;
+    hole->size = block->size;
+    hole->process_id = block->process_id;
+    hole->arrival_time = block->arrival_time;
+    hole->allocation_time = block->allocation_time;
+    hole->owner = block->owner;
+    if (hole->owner != NULL) {
+        hole->owner->memory_address = hole->start_address;
+    }
+
+    block->start_address = hole->start_address + hole->size;
+    block->size = hole_size;
+    block->is_free = true;
+    block->process_id = -1;
+    block->arrival_time = -1;
+    block->allocation_time = -1;
+    block->owner = NULL;
+
+    MemoryBlock* next = block->next;
+    if (next != NULL && next->is_free) {
+        fragmentation_remove_free(block->size);
+        fragmentation_remove_free(next->size);
+        fragmentation_add_free(block->size + next->size);
+        block->size += next->size;
+        block->next = next->next;
+        free(next);
+        memory_block_count--;
+    }
+
+    return hole->size;
+}
+
+// Find the hole from which sliding blocks down opens a hole of at least
+// `needed` MB for the least copying. Blocks larger than the per-step budget
+// can never be moved, so windows containing one are skipped.
+MemoryBlock* find_compaction_window(int needed) {
+    MemoryBlock* best = NULL;
+    int best_cost = 0;
+
+    for (MemoryBlock* start = memory_head; start != NULL; start = start->next) {
+        if (!start->is_free) {
+            continue;
+        }
+
+        int free_size = 0;
+        int cost = 0;
+        MemoryBlock* current = start;
+        while (current != NULL && free_size < needed) {
+            if (current->is_free) {
+                free_size += current->size;
+            } else {
+                if (current->size > compaction_step_budget) break;
+                cost += current->size;
+                if (best != NULL && cost >= best_cost) break;
+            }
+            current = current->next;
+        }
+
+        if (free_size >= needed && (best == NULL || cost < best_cost)) {
+            best = start;
+            best_cost = cost;
+        }
+    }
+    return best;
+}
+
+// One bounded step of incremental compaction. When the head of the waiting
+// queue does not fit anywhere but would fit in the total free memory, moves
+// go toward the cheapest window that opens a big enough hole for it.
+// Otherwise holes are pushed up starting from the lowest address.
+void compact_incremental_step() {
+    int budget = compaction_step_budget;
+    int moved = 0;
+    int moves = 0;
+    int needed = 0;
+
+    if (waiting_queue_size > 0) {
+        int head_size = waiting_queue[0]->size;
+        if (head_size > fragmentation.largest_free && head_size <= fragmentation.total_free) {
+            needed = head_size;
+        }
+    }
+
+    MemoryBlock* hole = needed > 0 ? find_compaction_window(needed) : NULL;
+    if (hole != NULL) {
+        // Slide blocks into this hole until it is big enough for the head
+        while (hole->size < needed && hole->next != NULL && !hole->next->is_free &&
+               hole->next->size <= budget) {
+            budget -= hole->next->size;
+            moved += slide_block_down(hole);
+            moves++;
+            hole = hole->next;
+        }
+    } else {
+        hole = memory_head;
+        while (hole != NULL) {
+            if (!hole->is_free || hole->next == NULL) {
+                hole = hole->next;
+                continue;
+            }
+            MemoryBlock* block = hole->next;
+            if (block->size > compaction_step_budget) {
+                // Too large to ever move in one step; continue above it
+                hole = block->next;
+                continue;
+            }
+            if (block->size > budget) {
+                break;
+            }
+            budget -= block->size;
+            moved += slide_block_down(hole);
+            moves++;
+            hole = hole->next;
+        }
+    }
+
+    if (moves > 0) {
+        stats.compactions++;
+        stats.compaction_moves += moves;
+        stats.compaction_mb_moved += moved;
+        stats.compaction_cost += (double)moved / compaction_copy_rate;
+        if (moved > stats.compaction_max_step_mb) {
+            stats.compaction_max_step_mb = moved;
+        }
+    }
+}
+
+// Compact memory and charge the copy to the simulation's cost accounting
+void run_compaction(const char* reason) {
+    if (fragmentation.free_block_count <= 1) {
+        return;
+    }
+
+    int moved = compact_memory();
+    stats.compactions++;
+    stats.compaction_mb_moved += moved;
+    stats.compaction_cost += (double)moved / compaction_copy_rate;
+    sim_log(COLOR_MAGENTA, "Compacted memory (%s): moved %d MB", reason, moved);
+}
+
+// Run a threshold or periodic compaction if one is due this time step
+void check_compaction_trigger() {
+    if (compaction_trigger == COMPACT_ON_THRESHOLD && fragmentation_index() >= compaction_threshold) {
+        run_compaction("fragmentation threshold");
+    } else if (compaction_trigger == COMPACT_PERIODIC && current_time % compaction_period == 0) {
+        run_compaction("periodic");
+    } else if (compaction_trigger == COMPACT_INCREMENTAL) {
+        compact_incremental_step();
+    }
+}
+
+// Allocate memory for a process, compacting first if the allocation failed
+// only because free memory is fragmented and the on-failure trigger is set
+bool allocate_or_compact(Process* process) {
+    if (allocate_memory(process)) {
+        return true;
+    }
+    if (compaction_trigger != COMPACT_ON_FAILURE || fragmentation.total_free < process->size) {
+        return false;
+    }
+
+    run_compaction("allocation failure");
+    if (allocate_memory(process)) {
+        stats.compaction_allocations++;
+        return true;
+    }
+    return false;
+}
+
+// Display name of a compaction trigger
+const char* compaction_trigger_name(CompactionTrigger trigger) {
+    switch (trigger) {
+        case COMPACT_ON_FAILURE: return "on allocation failure";
+        case COMPACT_ON_THRESHOLD: return "fragmentation threshold";
+        case COMPACT_PERIODIC: return "periodic";
+        case COMPACT_INCREMENTAL: return "incremental";
+        default: return "never";
+    }
+}
+
+// Whether the process in this block may be swapped out. A process must have
+// run for swap_min_residency time units first, so it is not thrashed.
+bool can_swap_out(const MemoryBlock* block) {
+    return !block->is_free && block->owner != NULL && block->owner->remaining_time > 0 &&
+           current_time - block->owner->allocation_time >= swap_min_residency;
+}
+
+// Find the run of consecutive blocks that forms a hole of at least `needed`
+// MB once the processes in it are swapped out, with the least swap I/O
+MemoryBlock* find_swap_window(int needed) {
+    MemoryBlock* best = NULL;
+    int best_cost = 0;
+
+    for (MemoryBlock* start = memory_head; start != NULL; start = start->next) {
+        if (!start->is_free && !can_swap_out(start)) {
+            continue;
+        }
+
+        int hole = 0;
+        int cost = 0;
+        MemoryBlock* current = start;
+        while (current != NULL && hole < needed) {
+            if (!current->is_free) {
+                if (!can_swap_out(current)) break;
+                cost += current->size;
+                if (best != NULL && cost >= best_cost) break;
+            }
+            hole += current->size;
+            current = current->next;
+        }
+
+        if (hole >= needed && (best == NULL || cost < best_cost)) {
+            best = start;
+            best_cost = cost;
+        }
+    }
+    return best;
+}
+
+// Evict a running process to backing store. The caller queues it to be
+// swapped back in.
+void swap_out_process(Process* process) {
+    deallocate_memory(process->pid);
+    process->allocated = false;
+    process->swapped_out = true;
+    process->swap_count++;
+
+    stats.swap_outs++;
+    stats.swap_mb_out += process->size;
+    sim_log(COLOR_MAGENTA, "Process %d swapped out (%d MB, %d remaining)", process->pid, process->size, process->remaining_time);
+}
+
+// If the head of the waiting queue has waited at least swap_wait_threshold,
+// swap out the cheapest set of neighbouring processes that makes room for it
+// and allocate it. The head leaves the queue before the victims join it, so
+// a victim that sorts ahead of it under the queue policy cannot be popped in
+// its place. Returns true if the head was allocated.
+bool swap_for_waiting_head() {
+    Process* head = waiting_queue[0];
+    if (swap_wait_threshold <= 0 || current_time - head->queued_time < swap_wait_threshold) {
+        return false;
+    }
+    if (head->size <= fragmentation.largest_free) {
+        return false;
+    }
+
+    MemoryBlock* start = find_swap_window(head->size);
+    if (start == NULL) {
+        return false;
+    }
+
+    // Collect the victims first: swapping out merges blocks under our feet
+    int victim_count = 0;
+    int hole = 0;
+    for (MemoryBlock* current = start; current != NULL && hole < head->size; current = current->next) {
+        if (!current->is_free) victim_count++;
+        hole += current->size;
+    }
+    Process** victims = (Process**)malloc(victim_count * sizeof(Process*));
+    if (victims == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    victim_count = 0;
+    hole = 0;
+    for (MemoryBlock* current = start; current != NULL && hole < head->size; current = current->next) {
+        if (!current->is_free) victims[victim_count++] = current->owner;
+        hole += current->size;
+    }
+
+    waiting_queue_pop();
+    for (int i = 0; i < victim_count; i++) {
+        swap_out_process(victims[i]);
+    }
+    bool allocated = allocate_memory(head);
+    if (allocated) {
+        sim_log(COLOR_GREEN, "Process %d allocated from waiting queue after swapping (time: %d)", head->pid, current_time);
+    } else {
+        waiting_queue_insert(head);
+    }
+    for (int i = 0; i < victim_count; i++) {
+        waiting_queue_enqueue(victims[i]);
+    }
+    free(victims);
+
+    return allocated;
+}
+
+// Whether process a goes before process b in the waiting queue
+static bool queue_before(const Process* a, const Process* b) {
+    if (a->queue_key != b->queue_key) {
+        return a->queue_key < b->queue_key;
+    }
+    return a->queue_order < b->queue_order;
+}
+
+// Add a process to the waiting queue heap, keeping its current key
+void waiting_queue_insert(Process* process) {
+    int index = waiting_queue_size++;
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!queue_before(process, waiting_queue[parent])) break;
+        waiting_queue[index] = waiting_queue[parent];
+        index = parent;
+    }
+    waiting_queue[index] = process;
+    stats.queue_operations++;
+}
+
+// Put a process in the waiting queue, with a key for the current policy.
+// Aging lowers the key of every waiter at the same rate over time, so
+// `run time - aging_rate x (now - queued_time)` orders the same way as the
+// fixed key `run time + aging_rate x queued_time`; no waiter is ever re-keyed.
+void waiting_queue_enqueue(Process* process) {
+    int run_time = process->swapped_out ? process->remaining_time : process->execution_time;
+
+    process->queued_time = current_time;
+    process->queue_order = queue_sequence++;
+    switch (queue_policy) {
+        case QUEUE_SJF: process->queue_key = run_time; break;
+        case QUEUE_SMALLEST_FIRST: process->queue_key = process->size; break;
+        case QUEUE_LARGEST_FIRST: process->queue_key = -process->size; break;
+        case QUEUE_AGING: process->queue_key = run_time + aging_rate * current_time; break;
+        default: process->queue_key = process->queue_order; break;
+    }
+    waiting_queue_insert(process);
+}
+
+// Remove and return the process at the head of the waiting queue
+Process* waiting_queue_pop() {
+    Process* head = waiting_queue[0];
+    Process* last = waiting_queue[--waiting_queue_size];
+    int index = 0;
+
+    while (1) {
+        int child = 2 * index + 1;
+        if (child >= waiting_queue_size) break;
+        if (child + 1 < waiting_queue_size && queue_before(waiting_queue[child + 1], waiting_queue[child])) {
+            child++;
+        }
+        if (!queue_before(waiting_queue[child], last)) break;
+        waiting_queue[index] = waiting_queue[child];
+        index = child;
+    }
+    if (waiting_queue_size > 0) {
+        waiting_queue[index] = last;
+    }
+    stats.queue_operations++;
+    return head;
+}
+
+// Empty the waiting queue into `order`, head first. Returns the count.
+int drain_waiting_queue(Process** order) {
+    int count = 0;
+    while (waiting_queue_size > 0) {
+        order[count++] = waiting_queue_pop();
+    }
+    return count;
+}
+
+static int compare_ints(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Find the earliest time a process can start, assuming running processes
+// finish on schedule and nothing else is allocated, and the address it
+// would get then. Returns false if it never fits.
+bool reserve_for_process(const Process* process, int* reserved_time, int* reserved_start) {
+    int count = memory_block_count;
+    int* starts = (int*)malloc(count * sizeof(int));
+    int* sizes = (int*)malloc(count * sizeof(int));
+    int* releases = (int*)malloc(count * sizeof(int));   // When each block becomes free
+    int* times = (int*)malloc(count * sizeof(int));
+    if (starts == NULL || sizes == NULL || releases == NULL || times == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+
+    int n = 0;
+    int time_count = 0;
+    for (MemoryBlock* current = memory_head; current != NULL; current = current->next) {
+        starts[n] = current->start_address;
+        sizes[n] = current->size;
+        if (current->is_free) {
+            releases[n] = current_time;
+        } else {
+            releases[n] = current->owner ? current_time + current->owner->remaining_time : INT_MAX;
+            times[time_count++] = releases[n];
+        }
+        n++;
+    }
+    qsort(times, time_count, sizeof(int), compare_ints);
+
+    bool found = false;
+    for (int t = 0; t < time_count && !found; t++) {
+        if (t > 0 && times[t] == times[t - 1]) {
+            continue;
+        }
+
+        // Best fit among the holes that exist once everything due by times[t] is freed
+        int best_size = 0;
+        int hole_start = 0;
+        int hole_size = 0;
+        for (int b = 0; b <= n; b++) {
+            if (b < n && releases[b] <= times[t]) {
+                if (hole_size == 0) hole_start = starts[b];
+                hole_size += sizes[b];
+                continue;
+            }
+            if (hole_size >= process->size && (best_size == 0 || hole_size < best_size)) {
+                best_size = hole_size;
+                *reserved_start = hole_start;
+            }
+            hole_size = 0;
+        }
+
+        if (best_size > 0) {
+            *reserved_time = times[t];
+            found = true;
+        }
+    }
+
+    free(starts);
+    free(sizes);
+    free(releases);
+    free(times);
+    return found;
+}
+
+// Compute the reservation for the waiting head
+void reserve_for_head(const Process* head, Reservation* reservation) {
+    reservation->head = head;
+    reservation->time = INT_MAX;
+    reservation->start = 0;
+    reservation->end = 0;
+    if (reserve_for_process(head, &reservation->time, &reservation->start)) {
+        reservation->end = reservation->start + head->size;
+    }
+}
+
+// Start a process ahead of the head if it finishes by the reserved time or
+// stays clear of the reserved range
+bool backfill_process(Process* process, const Reservation* reservation) {
+    int run_time = process->swapped_out ? process->remaining_time : process->execution_time;
+    bool done_in_time = current_time + run_time <= reservation->time;
+
+    bool started = done_in_time ? allocate_memory(process)
+                                : allocate_memory_outside(process, reservation->start, reservation->end);
+    if (started) {
+        sim_log(COLOR_CYAN, "Process %d backfilled ahead of Process %d (reserved at time %d)",
+                process->pid, reservation->head->pid, reservation->time);
+        stats.backfilled_processes++;
+    }
+    return started;
+}
+
+// EASY backfilling: start the queue head whenever it fits. If it does not,
+// reserve the earliest time and address range it can have, and let later
+// processes jump ahead only if they finish by then or stay clear of the range.
+int backfill_waiting_processes() {
+    int allocated = 0;
+
+    while (waiting_queue_size > 0 && allocate_or_compact(waiting_queue[0])) {
+        sim_log(COLOR_GREEN, "Process %d allocated from waiting queue (time: %d)", waiting_queue[0]->pid, current_time);
+        waiting_queue_pop();
+        allocated++;
+    }
+    if (waiting_queue_size <= 1) {
+        return allocated;
+    }
+
+    Process* head = waiting_queue[0];
+    Reservation reservation;
+    reserve_for_head(head, &reservation);
+
+    int count = drain_waiting_queue(waiting_order);
+    waiting_queue_insert(head);
+    for (int i = 1; i < count; i++) {
+        if (backfill_process(waiting_order[i], &reservation)) {
+            allocated++;
+        } else {
+            waiting_queue_insert(waiting_order[i]);
+        }
+    }
+    return allocated;
+}
+
+// Check if any waiting processes can now be allocated
+void check_waiting_processes() {
+    if (waiting_queue_size == 0) {
+        return;
+    }
     
-    while (current != NULL) {
-        if (!current->is_free) {
-            total_used += current->size;
+    int allocated_from_queue = 0;
+    int i;
+    
+    if (backfilling_enabled) {
+        allocated_from_queue = backfill_waiting_processes();
+    } else {
+        // Try every waiter in policy order; the ones that do not fit go back
+        int count = drain_waiting_queue(waiting_order);
+        for (i = 0; i < count; i++) {
+            if (allocate_or_compact(waiting_order[i])) {
+                sim_log(COLOR_GREEN, "Process %d allocated from waiting queue (time: %d)", waiting_order[i]->pid, current_time);
+                allocated_from_queue++;
+            } else {
+                waiting_queue_insert(waiting_order[i]);
+            }
+        }
+    }
+    
+    if (waiting_queue_size > 0 && swap_for_waiting_head()) {
+        allocated_from_queue++;
+    }
+    
+    if (allocated_from_queue > 0) {
+        sim_log(COLOR_GREEN, "Allocated %d processes from waiting queue", allocated_from_queue);
+        if (waiting_queue_size > 0) {
+            sim_log(COLOR_YELLOW, "%d processes still waiting", waiting_queue_size);
+        }
+    }
+}
+
+// Check for process completion and deallocate finished processes
+void check_process_completion() {
+    int i = 0;
+    while (i < allocated_count) {
+        Process* proc = allocated_processes[i];
+        int pid = proc->pid;
+        
+        if (!proc->completed) {
+            // Decrement remaining time for the process
+            proc->remaining_time--;
+            
+            // Check if process has completed
+            if (proc->remaining_time <= 0) {
+                sim_log(COLOR_GREEN, "Process %d has finished execution at time %d", pid, current_time);
+                deallocate_memory(pid);
+                // Don't increment i since the array has shifted
+            } else {
+                i++; // Move to next process
+            }
+        } else {
+            i++; // Move to next process
+        }
+    }
+}
+
+// Account for the time memory_used has held its current value. Must be
+// called just before memory_used changes.
+void utilization_advance(int now) {
+    int elapsed = now - utilization.last_change_time;
+    if (elapsed <= 0 || total_memory_size <= 0) {
+        return;
+    }
+
+    int level = (int)((long long)memory_used * UTILIZATION_LEVELS / total_memory_size);
+    utilization.used_time += (double)memory_used * elapsed;
+    utilization.time_at_level[level] += elapsed;
+    utilization.last_change_time = now;
+}
+
+// Utilization (0-1) that memory stayed at or below for the given fraction of time
+double utilization_percentile(double fraction) {
+    double total_time = 0;
+    int level;
+    for (level = 0; level <= UTILIZATION_LEVELS; level++) {
+        total_time += utilization.time_at_level[level];
+    }
+    if (total_time == 0) {
+        return 0;
+    }
+
+    double cumulative = 0;
+    for (level = 0; level <= UTILIZATION_LEVELS; level++) {
+        cumulative += utilization.time_at_level[level];
+        if (cumulative >= fraction * total_time) {
+            break;
+        }
+    }
+    return (double)level / UTILIZATION_LEVELS;
+}
+
+#ifdef OP_TIMING
+// Read the operation timer
+unsigned long long op_timer_now() {
+#if defined(OP_TIMING_TSC) && (defined(__x86_64__) || defined(__i386__))
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+// Bucket holding a value: values below LATENCY_SUB_BUCKETS map to themselves,
+// larger ones to (power of two, top LATENCY_SUB_BUCKET_BITS bits below it)
+static int latency_bucket(unsigned long long value) {
+    if (value < LATENCY_SUB_BUCKETS) {
+        return (int)value;
+    }
+    int shift = 63 - __builtin_clzll(value) - LATENCY_SUB_BUCKET_BITS;
+    return (shift + 1) * LATENCY_SUB_BUCKETS + (int)((value >> shift) - LATENCY_SUB_BUCKETS);
+}
+
+// Largest value that falls into a bucket
+static unsigned long long latency_bucket_limit(int bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    unsigned long long base = (unsigned long long)(bucket % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS) << shift;
+    return base + (1ULL << shift) - 1;
+}
+
+// Add one measurement to a histogram
+void latency_record(LatencyHistogram* histogram, unsigned long long value) {
+    if (histogram->count == 0 || value < histogram->min) {
+        histogram->min = value;
+    }
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+    histogram->count++;
+    histogram->total += value;
+    histogram->buckets[latency_bucket(value)]++;
+}
+
+// Value at or below which the given fraction of measurements fall
+unsigned long long latency_percentile(const LatencyHistogram* histogram, double fraction) {
+    double exact = fraction * histogram->count;
+    unsigned long long target = (unsigned long long)exact;
+    if (target < exact) {
+        target++;
+    }
+    unsigned long long seen = 0;
+
+    for (int bucket = 0; bucket < LATENCY_BUCKET_COUNT; bucket++) {
+        seen += histogram->buckets[bucket];
+        if (seen > 0 && seen >= target) {
+            unsigned long long limit = latency_bucket_limit(bucket);
+            return limit < histogram->max ? limit : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+// Print the per-operation latency table
+void display_op_latency() {
+    printf("\n%sOperation Latency (%s):%s\n", BOLD, OP_TIMING_UNIT, COLOR_RESET);
+    printf("  %-18s %10s %8s %10s %8s %8s %8s %10s\n",
+           "Operation", "Count", "Min", "Mean", "p50", "p90", "p99", "Max");
+
+    for (int op = 0; op < OP_COUNT; op++) {
+        const LatencyHistogram* histogram = &op_latency[op];
+        if (histogram->count == 0) {
+            printf("  %-18s %10d\n", op_names[op], 0);
+            continue;
+        }
+        printf("  %s%-18s%s %10llu %8llu %10.1f %8llu %8llu %8llu %10llu\n",
+               COLOR_BLUE, op_names[op], COLOR_RESET,
+               histogram->count, histogram->min,
+               (double)histogram->total / histogram->count,
+               latency_percentile(histogram, 0.50),
+               latency_percentile(histogram, 0.90),
+               latency_percentile(histogram, 0.99),
+               histogram->max);
+    }
+    printf("  %s(deallocate_memory includes its merge_free_blocks call)%s\n", COLOR_BRIGHT_BLACK, COLOR_RESET);
+}
+#endif
+
+#ifdef PHASE_TIMING
+// Read the phase timer in nanoseconds
+unsigned long long phase_timer_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+// Add one timed interval of a phase to its totals and, if enabled, the trace
+void phase_record(SimulationPhase phase, unsigned long long started, unsigned long long ended) {
+    unsigned long long elapsed = ended - started;
+    PhaseTotals* totals = &phase_totals[phase];
+
+    totals->count++;
+    totals->total_ns += elapsed;
+    if (elapsed > totals->max_ns) {
+        totals->max_ns = elapsed;
+    }
+    if (!phase_trace_enabled) {
+        return;
+    }
+
+    if (phase_thread == 0) {
+        phase_thread = atomic_fetch_add(&phase_thread_count, 1) + 1;
+    }
+    pthread_mutex_lock(&phase_trace_lock);
+    if (phase_trace.count == phase_trace.capacity && phase_trace.capacity < PHASE_TRACE_MAX_EVENTS) {
+        int capacity = phase_trace.capacity ? phase_trace.capacity * 2 : 4096;
+        if (capacity > PHASE_TRACE_MAX_EVENTS) {
+            capacity = PHASE_TRACE_MAX_EVENTS;
+        }
+        PhaseEvent* events = realloc(phase_trace.events, capacity * sizeof(PhaseEvent));
+        if (events != NULL) {
+            phase_trace.events = events;
+            phase_trace.capacity = capacity;
+        }
+    }
+    if (phase_trace.count < phase_trace.capacity) {
+        PhaseEvent* event = &phase_trace.events[phase_trace.count++];
+        event->start_ns = started - phase_trace.origin_ns;
+        event->duration_ns = elapsed;
+        event->phase = phase;
+        event->thread = phase_thread;
+    } else {
+        phase_trace.dropped++;
+    }
+    pthread_mutex_unlock(&phase_trace_lock);
+}
+
+// Clear the totals and the trace at the start of a run
+void phase_timing_reset() {
+    memset(phase_totals, 0, sizeof(phase_totals));
+    phase_trace.count = 0;
+    phase_trace.dropped = 0;
+    phase_trace.origin_ns = phase_timer_now();
+}
+
+// Print the per-phase totals, with each phase's share of the timed time
+void display_phase_timing() {
+    unsigned long long all_phases_ns = 0;
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        all_phases_ns += phase_totals[phase].total_ns;
+    }
+
+    printf("\n%sPhase Timing (ns):%s\n", BOLD, COLOR_RESET);
+    printf("  %-28s %10s %14s %10s %10s %7s\n", "Phase", "Count", "Total", "Mean", "Max", "Share");
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        const PhaseTotals* totals = &phase_totals[phase];
+        if (totals->count == 0) {
+            printf("  %-28s %10d\n", phase_names[phase], 0);
+            continue;
+        }
+        printf("  %s%-28s%s %10llu %14llu %10.1f %10llu %6.1f%%\n",
+               COLOR_BLUE, phase_names[phase], COLOR_RESET,
+               totals->count, totals->total_ns,
+               (double)totals->total_ns / totals->count, totals->max_ns,
+               all_phases_ns > 0 ? 100.0 * totals->total_ns / all_phases_ns : 0.0);
+    }
+}
+
+// Write the recorded intervals as complete ("X") events in the Chrome
+// trace-event format, with timestamps in microseconds
+void phase_trace_write(const char* filename) {
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        fprintf(stderr, "%sCould not open %s: %s%s\n", COLOR_RED, filename, strerror(errno), COLOR_RESET);
+        return;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    int threads = atomic_load(&phase_thread_count);
+    for (int thread = 1; thread <= threads; thread++) {
+        fprintf(file, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                      "\"args\": {\"name\": \"tes3 thread %d\"}},\n", thread, thread);
+    }
+    for (int i = 0; i < phase_trace.count; i++) {
+        const PhaseEvent* event = &phase_trace.events[i];
+        fprintf(file, "  {\"name\": \"%s\", \"cat\": \"simulation\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                      "\"ts\": %.3f, \"dur\": %.3f}%s\n",
+                phase_names[event->phase], event->thread, event->start_ns / 1000.0,
+                event->duration_ns / 1000.0, i + 1 < phase_trace.count ? "," : "");
+    }
+    fprintf(file, "]}\n");
+    fclose(file);
+
+    printf("%sPhase trace (%d events) written to %s%s\n", COLOR_GREEN, phase_trace.count, filename, COLOR_RESET);
+    if (phase_trace.dropped > 0) {
+        printf("%s%ld events past the first %d were not recorded%s\n",
+               COLOR_YELLOW, phase_trace.dropped, PHASE_TRACE_MAX_EVENTS, COLOR_RESET);
+    }
+}
+#endif
+
+// Size class of a free block: floor(log2(size))
+static int free_size_class(int size) {
+    int size_class = 31 - __builtin_clz((unsigned)size);
+    return size_class < FREE_SIZE_CLASSES ? size_class : FREE_SIZE_CLASSES - 1;
+}
+
+// Clear the fragmentation metrics for a memory of the given size
+void fragmentation_reset(int size) {
+    FILE* log = fragmentation.log;
+    free(fragmentation.free_size_count);
+    memset(&fragmentation, 0, sizeof(fragmentation));
+    fragmentation.log = log;
+
+    if (size > 0) {
+        fragmentation.free_size_count = (int*)calloc(size + 1, sizeof(int));
+        if (fragmentation.free_size_count == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+    }
+}
+
+// A free block of this size appeared (split remainder, free or merge result)
+void fragmentation_add_free(int size) {
+    if (size <= 0) {
+        return;
+    }
+    fragmentation.free_block_count++;
+    fragmentation.total_free += size;
+    fragmentation.free_size_count[size]++;
+    fragmentation.size_class_count[free_size_class(size)]++;
+    if (size > fragmentation.largest_free) {
+        fragmentation.largest_free = size;
+    }
+}
+
+// A free block of this size went away (allocated or merged). When the last
+// block of the largest size goes, the new largest is found by stepping down
+// through the size counts, starting from the highest non-empty size class.
+void fragmentation_remove_free(int size) {
+    if (size <= 0) {
+        return;
+    }
+    fragmentation.free_block_count--;
+    fragmentation.total_free -= size;
+    fragmentation.free_size_count[size]--;
+    fragmentation.size_class_count[free_size_class(size)]--;
+
+    if (size != fragmentation.largest_free || fragmentation.free_size_count[size] > 0) {
+        return;
+    }
+
+    int size_class = free_size_class(size);
+    while (size_class >= 0 && fragmentation.size_class_count[size_class] == 0) {
+        size_class--;
+    }
+    if (size_class < 0) {
+        fragmentation.largest_free = 0;
+        return;
+    }
+
+    int candidate = size < (2 << size_class) ? size : (2 << size_class) - 1;
+    while (fragmentation.free_size_count[candidate] == 0) {
+        candidate--;
+    }
+    fragmentation.largest_free = candidate;
+}
+
+// External fragmentation index: 1 - largest free block / total free memory.
+// 0 when all free memory is one block (or nothing is free).
+double fragmentation_index() {
+    if (fragmentation.total_free == 0) {
+        return 0;
+    }
+    return 1.0 - (double)fragmentation.largest_free / fragmentation.total_free;
+}
+
+// Record the fragmentation metrics for the current time step
+void record_fragmentation_sample() {
+    double index = fragmentation_index();
+
+    fragmentation.samples++;
+    fragmentation.index_sum += index;
+    stats.avg_fragmentation_index = fragmentation.index_sum / fragmentation.samples;
+    if (index > stats.peak_fragmentation_index) {
+        stats.peak_fragmentation_index = index;
+    }
+    if (fragmentation.free_block_count > stats.peak_free_blocks) {
+        stats.peak_free_blocks = fragmentation.free_block_count;
+    }
+
+    if (fragmentation.log != NULL) {
+        fprintf(fragmentation.log, "%d,%d,%d,%d,%.4f", current_time,
+                fragmentation.free_block_count, fragmentation.largest_free,
+                fragmentation.total_free, index);
+        for (int i = 0; i < FREE_SIZE_CLASSES; i++) {
+            fprintf(fragmentation.log, ",%d", fragmentation.size_class_count[i]);
         }
-        current = current->next;
+        fprintf(fragmentation.log, "\n");
     }
-    
-    double utilization = (double)total_used / total_memory_size;
-    // Update the running average
-    if (stats.memory_utilization == 0) {
-        stats.memory_utilization = utilization;
-    } else {
-        stats.memory_utilization = (stats.memory_utilization + utilization) / 2.0;
+}
+
+// Start exporting the per-step fragmentation time series as CSV
+void fragmentation_log_open(const char* filename) {
+    fragmentation.log = fopen(filename, "w");
+    if (fragmentation.log == NULL) {
+        printf("%sCould not open file %s for writing.%s\n", COLOR_RED, filename, COLOR_RESET);
+        return;
+    }
+
+    fprintf(fragmentation.log, "time,free_blocks,largest_free_mb,total_free_mb,fragmentation_index");
+    for (int i = 0; i < FREE_SIZE_CLASSES; i++) {
+        fprintf(fragmentation.log, ",free_%dmb", 1 << i);
+    }
+    fprintf(fragmentation.log, "\n");
+}
+
+// Finish the fragmentation time series
+void fragmentation_log_close() {
+    if (fragmentation.log != NULL) {
+        fclose(fragmentation.log);
+        fragmentation.log = NULL;
+        printf("%sFragmentation time series saved to %s%s\n", COLOR_GREEN, FRAGMENTATION_LOG_FILE, COLOR_RESET);
+    }
+}
+
+// Calculate memory utilization as the time-weighted mean of memory use
+// from the start of the run up to now. O(1): closes the integral to now.
+void calculate_memory_utilization() {
+    utilization_advance(current_time);
+    if (current_time > 0 && total_memory_size > 0) {
+        stats.memory_utilization = utilization.used_time / ((double)current_time * total_memory_size);
     }
 }
 
 // Advance the simulation by one time unit
 void simulate_time_step() {
     current_time++;
+    PHASE_TIMER_START(PHASE_COMPLETION);
     check_process_completion();
+    PHASE_TIMER_STOP(PHASE_COMPLETION);
+    check_compaction_trigger();
+    PHASE_TIMER_START(PHASE_WAITING);
     check_waiting_processes();
+    PHASE_TIMER_STOP(PHASE_WAITING);
+    PHASE_TIMER_START(PHASE_UTILIZATION);
     calculate_memory_utilization();
+    PHASE_TIMER_STOP(PHASE_UTILIZATION);
+    record_fragmentation_sample();
 }
 
-// Add a process to be allocated
-bool add_process(Process* process) {
+// Add a process to be allocated. With backfilling, a waiting head holds a
+// reservation, so a newcomer may only start the way a backfilled process
+// would; `reservation` caches the head's reservation across one tick.
+bool add_process(Process* process, Reservation* reservation) {
     // If the process arrival time is in the future, queue it
     if (process->arrival_time > current_time) {
-        printf("%sProcess %d will arrive at time %d%s\n", 
-               COLOR_YELLOW, process->pid, process->arrival_time, COLOR_RESET);
+        sim_log(COLOR_YELLOW, "Process %d will arrive at time %d", process->pid, process->arrival_time);
         return false;
     }
     
+    if (backfilling_enabled && waiting_queue_size > 0) {
+        // No free block is big enough, so skip computing the reservation
+        if (process->size <= fragmentation.largest_free) {
+            if (reservation->head != waiting_queue[0]) {
+                reserve_for_head(waiting_queue[0], reservation);
+            }
+            if (backfill_process(process, reservation)) {
+                return true;
+            }
+        }
+        sim_log(COLOR_YELLOW, "Process %d queued behind Process %d's reservation", process->pid, waiting_queue[0]->pid);
+        waiting_queue_enqueue(process);
+        return false;
+    }
+
     // Try to allocate memory
-    if (allocate_memory(process)) {
-        printf("%sProcess %d allocated successfully (time: %d, exec time: %d)%s\n", 
-               COLOR_GREEN, process->pid, current_time, process->execution_time, COLOR_RESET);
+    if (allocate_or_compact(process)) {
+        sim_log(COLOR_GREEN, "Process %d allocated successfully (time: %d, exec time: %d)", process->pid, current_time, process->execution_time);
         return true;
     } else {
         // If allocation fails, add to waiting queue
-        printf("%sNot enough memory for Process %d. Added to waiting queue.%s\n", 
-               COLOR_RED, process->pid, COLOR_RESET);
-        waiting_queue[waiting_queue_size++] = process;
+        sim_log(COLOR_RED, "Not enough memory for Process %d. Added to waiting queue.", process->pid);
+        waiting_queue_enqueue(process);
         return false;
     }
 }
 
+// Add every process whose arrival time has been reached. Processes are
+// sorted by arrival time, so next_process only ever moves forward.
+void admit_arrivals(int* next_process, int num_processes) {
+    PHASE_TIMER_START(PHASE_ARRIVALS);
+    Reservation reservation = { NULL, INT_MAX, 0, 0 };
+    while (*next_process < num_processes &&
+           processes[*next_process].arrival_time <= current_time) {
+        add_process(&processes[*next_process], &reservation);
+        (*next_process)++;
+    }
+    PHASE_TIMER_STOP(PHASE_ARRIVALS);
+}
+
 // Create sample processes with varying sizes, arrival times, and execution times
 Process* create_sample_processes(int num_processes) {
     Process* processes = (Process*)malloc(num_processes * sizeof(Process));
@@ -549,6 +2354,10 @@ Process* create_sample_processes(int num_processes) {
         processes[i].memory_address = -1;
         processes[i].waiting_time = 0;
         processes[i].completed = false;
+        processes[i].completion_time = -1;
+        processes[i].queued_time = -1;
+        processes[i].swapped_out = false;
+        processes[i].swap_count = 0;
     }
     
     // Sort by arrival time using bubble sort (simple enough for this case)
@@ -566,8 +2375,9 @@ Process* create_sample_processes(int num_processes) {
     return processes;
 }
 
-// Read processes from file (improved to handle comments and validate data)
-int read_processes_from_file(const char* filename, Process* processes) {
+// Read processes from file into the process table, growing it as needed
+// (improved to handle comments and validate data)
+int read_processes_from_file(const char* filename) {
     FILE* file = fopen(filename, "r");
     int count = 0;
     char line[256];
@@ -577,9 +2387,11 @@ int read_processes_from_file(const char* filename, Process* processes) {
         return 0;
     }
     
-    printf("%sReading processes from %s...%s\n", COLOR_BLUE, filename, COLOR_RESET);
+    if (!quiet) {
+        printf("%sReading processes from %s...%s\n", COLOR_BLUE, filename, COLOR_RESET);
+    }
     
-    while (count < MAX_PROCESSES && fgets(line, sizeof(line), file)) {
+    while (fgets(line, sizeof(line), file)) {
         // Skip comments and empty lines
         if (line[0] == '#' || line[0] == '\n' || (line[0] == '\r' && line[1] == '\n')) {
             continue;
@@ -594,6 +2406,7 @@ int read_processes_from_file(const char* filename, Process* processes) {
                 continue;
             }
             
+            reserve_processes(count + 1);
             processes[count].pid = pid;
             processes[count].arrival_time = arrival;
             processes[count].size = size;
@@ -604,6 +2417,10 @@ int read_processes_from_file(const char* filename, Process* processes) {
             processes[count].memory_address = -1;
             processes[count].waiting_time = 0;
             processes[count].completed = false;
+            processes[count].completion_time = -1;
+            processes[count].queued_time = -1;
+            processes[count].swapped_out = false;
+            processes[count].swap_count = 0;
             count++;
         } else {
             printf("%sInvalid format in line: %s%s\n", COLOR_RED, line, COLOR_RESET);
@@ -611,7 +2428,9 @@ int read_processes_from_file(const char* filename, Process* processes) {
     }
     
     fclose(file);
-    printf("%sSuccessfully read %d processes%s\n", COLOR_GREEN, count, COLOR_RESET);
+    if (!quiet) {
+        printf("%sSuccessfully read %d processes%s\n", COLOR_GREEN, count, COLOR_RESET);
+    }
     return count;
 }
 
@@ -641,44 +2460,40 @@ void save_processes_to_file(Process* processes, int count, const char* filename)
     printf("%sSaved %d processes to %s%s\n", COLOR_GREEN, count, filename, COLOR_RESET);
 }
 
-// Display all currently allocated processes
-void display_allocated_processes() {
-    if (allocated_count == 0) {
-        printf("%sNo processes currently allocated in memory.%s\n", COLOR_YELLOW, COLOR_RESET);
+// Render the allocated process table, capped at render_row_limit rows
+void render_allocated_processes(FrameBuffer* fb, const MemorySnapshot* snap) {
+    if (snap->allocated_count == 0) {
+        frame_append(fb, "%sNo processes currently allocated in memory.%s\n", COLOR_YELLOW, COLOR_RESET);
         return;
     }
-    
-    printf("\n%s%sALLOCATED PROCESSES%s\n", BOLD, COLOR_CYAN, COLOR_RESET);
-    print_separator('-');
-    
-    printf("%-6s %-8s %-10s %-10s %-12s %-10s %-10s\n", 
+
+    frame_append(fb, "\n%s%sALLOCATED PROCESSES%s\n", BOLD, COLOR_CYAN, COLOR_RESET);
+    frame_separator(fb, '-');
+
+    frame_append(fb, "%-6s %-8s %-10s %-10s %-12s %-10s %-10s\n",
            "PID", "Size", "Address", "Arrival", "Allocation", "Wait", "Remaining");
-    print_separator('-');
-    
+    frame_separator(fb, '-');
+
     int i;
-    for (i = 0; i < allocated_count; i++) {
-        int pid = allocated_processes[i];
-        int j;
-        
-        // Find the process in our process array
-        for (j = 0; j < MAX_PROCESSES; j++) {
-            if (processes[j].pid == pid && processes[j].allocated) {
-                printf("%s%-6d%s %-8d %-10d %-10d %-12d %-10d %s%-10d%s\n",
-                       COLOR_RED, processes[j].pid, COLOR_RESET, 
-                       processes[j].size, 
-                       processes[j].memory_address,
-                       processes[j].arrival_time, 
-                       processes[j].allocation_time, 
-                       processes[j].waiting_time, 
-                       (processes[j].remaining_time <= 2) ? COLOR_YELLOW : COLOR_BLUE,
-                       processes[j].remaining_time,
-                       COLOR_RESET);
-                break;
-            }
-        }
+    for (i = 0; i < snap->allocated_rows; i++) {
+        const Process* proc = &snap->allocated[i];
+        frame_append(fb, "%s%-6d%s %-8d %-10d %-10d %-12d %-10d %s%-10d%s\n",
+               COLOR_RED, proc->pid, COLOR_RESET,
+               proc->size,
+               proc->memory_address,
+               proc->arrival_time,
+               proc->allocation_time,
+               proc->waiting_time,
+               (proc->remaining_time <= 2) ? COLOR_YELLOW : COLOR_BLUE,
+               proc->remaining_time,
+               COLOR_RESET);
     }
-    
-    print_separator('-');
+    if (snap->allocated_rows < snap->allocated_count) {
+        frame_append(fb, "%s... %d more processes%s\n", COLOR_BRIGHT_BLACK,
+                     snap->allocated_count - snap->allocated_rows, COLOR_RESET);
+    }
+
+    frame_separator(fb, '-');
 }
 
 // Display simulation statistics
@@ -693,19 +2508,61 @@ void display_simulation_stats() {
     printf("  %sSuccessful allocations:%s %d\n", COLOR_GREEN, COLOR_RESET, stats.successful_allocations);
     printf("  %sFailed allocations:%s %d\n", COLOR_RED, COLOR_RESET, stats.failed_allocations);
     printf("  %sCompleted processes:%s %d\n", COLOR_GREEN, COLOR_RESET, stats.completed_processes);
-    printf("  %sFragmentation events:%s %d\n", COLOR_YELLOW, COLOR_RESET, stats.total_fragmentation_events);
+    printf("  %sFragmentation events:%s %d (failed with enough total free memory)\n", COLOR_YELLOW, COLOR_RESET, stats.total_fragmentation_events);
+
+    if (compaction_trigger != COMPACT_NEVER) {
+        printf("\n%sCompaction (%s):%s\n", BOLD, compaction_trigger_name(compaction_trigger), COLOR_RESET);
+        printf("  %sCompactions:%s %d\n", COLOR_CYAN, COLOR_RESET, stats.compactions);
+        printf("  %sMemory moved:%s %d MB (%.2f time units at %d MB/unit)\n", COLOR_CYAN, COLOR_RESET,
+               stats.compaction_mb_moved, stats.compaction_cost, compaction_copy_rate);
+        printf("  %sAllocations gained:%s %d\n", COLOR_CYAN, COLOR_RESET, stats.compaction_allocations);
+        if (compaction_trigger == COMPACT_INCREMENTAL) {
+            printf("  %sBlocks moved:%s %d (at most %d MB in one step, budget %d MB)\n", COLOR_CYAN, COLOR_RESET,
+                   stats.compaction_moves, stats.compaction_max_step_mb, compaction_step_budget);
+        }
+    }
+
+    printf("\n%sQueue policy:%s %s", BOLD, COLOR_RESET, queue_policy_names[queue_policy]);
+    if (queue_policy == QUEUE_AGING) {
+        printf(" (rate %.2f)", aging_rate);
+    }
+    printf(", %lld heap operations\n", stats.queue_operations);
+
+    if (backfilling_enabled) {
+        printf("\n%sBackfilling:%s %d processes started ahead of the queue head\n", BOLD, COLOR_RESET, stats.backfilled_processes);
+    }
+
+    if (swap_wait_threshold > 0) {
+        printf("\n%sSwapping (after %d units waiting):%s\n", BOLD, swap_wait_threshold, COLOR_RESET);
+        printf("  %sSwap outs / ins:%s %d / %d\n", COLOR_CYAN, COLOR_RESET, stats.swap_outs, stats.swap_ins);
+        printf("  %sSwap I/O:%s %d MB out, %d MB in (%.2f time units at %d MB/unit)\n", COLOR_CYAN, COLOR_RESET,
+               stats.swap_mb_out, stats.swap_mb_in,
+               (double)(stats.swap_mb_out + stats.swap_mb_in) / swap_io_rate, swap_io_rate);
+    }
+
+    printf("\n%sFragmentation Metrics:%s\n", BOLD, COLOR_RESET);
+    printf("  %sFragmentation index:%s %.3f mean, %.3f peak (1 - largest free / total free)\n",
+           COLOR_MAGENTA, COLOR_RESET, stats.avg_fragmentation_index, stats.peak_fragmentation_index);
+    printf("  %sFree blocks:%s %d now, %d peak\n", COLOR_MAGENTA, COLOR_RESET,
+           fragmentation.free_block_count, stats.peak_free_blocks);
+    printf("  %sFree size histogram:%s", COLOR_MAGENTA, COLOR_RESET);
+    for (int i = 0; i < FREE_SIZE_CLASSES; i++) {
+        if (fragmentation.size_class_count[i] > 0) {
+            printf(" [%d-%d MB]: %d", 1 << i, (2 << i) - 1, fragmentation.size_class_count[i]);
+        }
+    }
+    printf("\n");
     
     // Calculate turnaround and waiting time statistics
-    int total_waiting_time = 0;
-    int total_turnaround_time = 0;
-    int total_execution_time = 0;
+    long long total_waiting_time = 0;
+    long long total_turnaround_time = 0;
+    long long total_execution_time = 0;
     int completed_count = 0;
     
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        if (processes[i].pid > 0 && processes[i].completed) {
+    for (int i = 0; i < process_count; i++) {
+        if (processes[i].completed) {
             total_waiting_time += processes[i].waiting_time;
-            total_turnaround_time += (processes[i].allocation_time + processes[i].execution_time) - 
-                                     processes[i].arrival_time;
+            total_turnaround_time += processes[i].completion_time - processes[i].arrival_time;
             total_execution_time += processes[i].execution_time;
             completed_count++;
         }
@@ -723,16 +2580,88 @@ void display_simulation_stats() {
         printf("  %sMaximum waiting time:%s %d time units\n", COLOR_RED, COLOR_RESET, stats.max_waiting_time);
     }
     
-    printf("\n%sMemory Utilization:%s %.2f%%\n", BOLD, COLOR_GREEN, stats.memory_utilization * 100);
+    calculate_memory_utilization();
+    stats.peak_memory_utilization = total_memory_size > 0 ? (double)utilization.peak_used / total_memory_size : 0;
+    stats.utilization_p50 = utilization_percentile(0.50);
+    stats.utilization_p95 = utilization_percentile(0.95);
+    stats.utilization_p99 = utilization_percentile(0.99);
+
+    printf("\n%sMemory Utilization:%s %.2f%% (time-weighted mean)\n", BOLD, COLOR_GREEN, stats.memory_utilization * 100);
     
     double utilization_visuals = stats.memory_utilization;
     print_progress_bar(utilization_visuals, BAR_LENGTH);
     printf("\n");
+    printf("  %sPeak:%s %.2f%%  %sp50:%s %.1f%%  %sp95:%s %.1f%%  %sp99:%s %.1f%%\n",
+           COLOR_WHITE, COLOR_RESET, stats.peak_memory_utilization * 100,
+           COLOR_WHITE, COLOR_RESET, stats.utilization_p50 * 100,
+           COLOR_WHITE, COLOR_RESET, stats.utilization_p95 * 100,
+           COLOR_WHITE, COLOR_RESET, stats.utilization_p99 * 100);
     
+#ifdef OP_TIMING
+    display_op_latency();
+#endif
+#ifdef PHASE_TIMING
+    display_phase_timing();
+#endif
+
+    display_policy_stats();
+
     printf("\n%sSimulation duration:%s %.4f seconds\n", COLOR_MAGENTA, COLOR_RESET, stats.simulation_duration);
     print_separator('=');
 }
 
+// Add the run that just finished to the totals of the current queue policy
+void record_policy_run() {
+    int* waits = (int*)malloc((process_count > 0 ? process_count : 1) * sizeof(int));
+    PolicyStats* ps = &policy_stats[queue_policy];
+    int count = 0;
+
+    if (waits == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    for (int i = 0; i < process_count; i++) {
+        if (processes[i].completed) {
+            waits[count++] = processes[i].waiting_time;
+            ps->total_waiting_time += processes[i].waiting_time;
+            ps->total_turnaround_time += processes[i].completion_time - processes[i].arrival_time;
+        }
+    }
+    qsort(waits, count, sizeof(int), compare_ints);
+
+    ps->runs++;
+    ps->completed += count;
+    ps->total_time += current_time;
+    ps->queue_operations += stats.queue_operations;
+    if (count > 0) {
+        if (waits[count - 1] > ps->max_waiting_time) {
+            ps->max_waiting_time = waits[count - 1];
+        }
+        ps->p95_waiting_time = waits[(95 * count + 99) / 100 - 1];
+    }
+    free(waits);
+}
+
+// Compare every queue policy that has been run this session
+void display_policy_stats() {
+    printf("\n%sQueue Policy Comparison:%s\n", BOLD, COLOR_RESET);
+    printf("  %-20s %5s %10s %10s %10s %12s %10s %12s\n",
+           "Policy", "Runs", "Avg wait", "p95 wait", "Max wait", "Turnaround", "Avg time", "Heap ops");
+    for (int i = 0; i < QUEUE_POLICY_COUNT; i++) {
+        const PolicyStats* ps = &policy_stats[i];
+        if (ps->runs == 0 || ps->completed == 0) continue;
+        printf("  %s%-20s%s %5d %10.2f %10d %10d %12.2f %10.1f %12lld\n",
+               i == (int)queue_policy ? COLOR_GREEN : COLOR_WHITE, queue_policy_names[i], COLOR_RESET,
+               ps->runs,
+               (double)ps->total_waiting_time / ps->completed,
+               ps->p95_waiting_time,
+               ps->max_waiting_time,
+               (double)ps->total_turnaround_time / ps->completed,
+               (double)ps->total_time / ps->runs,
+               ps->queue_operations / ps->runs);
+    }
+}
+
 // Free all allocated memory at the end
 void free_memory() {
     MemoryBlock* current = memory_head;
@@ -742,14 +2671,597 @@ void free_memory() {
         current = next;
     }
     memory_head = NULL;
+    memory_block_count = 0;
+    memory_used = 0;
+    fragmentation_reset(0);
+}
+
+// Simulation thread: runs time steps back to back with no display delay and
+// only copies state out when the render thread has asked for a frame
+void* simulation_thread(void* arg) {
+    int num_processes = *(int*)arg;
+    int current_process = 0;
+
+    while (current_process < num_processes || allocated_count > 0 || waiting_queue_size > 0) {
+        admit_arrivals(&current_process, num_processes);
+        simulate_time_step();
+
+        if (atomic_load_explicit(&snapshot_requested, memory_order_acquire)) {
+            publish_snapshot(false);
+        }
+    }
+
+    // The final frame goes through the same handshake, so it never
+    // overwrites a snapshot the renderer is still drawing
+    pthread_mutex_lock(&snapshot_lock);
+    while (!atomic_load_explicit(&snapshot_requested, memory_order_acquire)) {
+        pthread_cond_wait(&snapshot_wanted, &snapshot_lock);
+    }
+    pthread_mutex_unlock(&snapshot_lock);
+    publish_snapshot(true);
+    return NULL;
+}
+
+// Render thread: draws the latest published snapshot at most render_fps
+// times per second until it has drawn the final one
+void* render_thread(void* arg) {
+    (void)arg;
+    long frame_interval_ns = 1000000000L / render_fps;
+    unsigned long drawn_sequence = 0;
+    struct timespec next_frame;
+    clock_gettime(CLOCK_MONOTONIC, &next_frame);
+
+    while (1) {
+        next_frame.tv_nsec += frame_interval_ns;
+        if (next_frame.tv_nsec >= 1000000000L) {
+            next_frame.tv_sec++;
+            next_frame.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_frame, NULL);
+
+        pthread_mutex_lock(&snapshot_lock);
+        unsigned long sequence = snapshot_sequence;
+        MemorySnapshot* snap = &snapshots[snapshot_front];
+        pthread_mutex_unlock(&snapshot_lock);
+
+        // The simulation does not publish again until it is asked for a
+        // new snapshot, which only happens after this frame is drawn
+        if (sequence != drawn_sequence) {
+            PHASE_TIMER_START(PHASE_RENDER);
+            if (display_mode == DISPLAY_DIFFERENTIAL) {
+                display_screen_differential(snap, false);
+            } else {
+                display_screen(snap, false);
+            }
+            PHASE_TIMER_STOP(PHASE_RENDER);
+            drawn_sequence = sequence;
+            if (snap->finished) {
+                break;
+            }
+
+            // Done with this snapshot: ask for the next one
+            pthread_mutex_lock(&snapshot_lock);
+            atomic_store_explicit(&snapshot_requested, true, memory_order_release);
+            pthread_cond_signal(&snapshot_wanted);
+            pthread_mutex_unlock(&snapshot_lock);
+        }
+    }
+    return NULL;
+}
+
+// Run the simulation on its own thread while a render thread samples it
+void run_simulation_threaded(int num_processes) {
+    pthread_t simulation, renderer;
+
+    snapshot_front = 0;
+    snapshot_sequence = 0;
+    atomic_store(&snapshot_requested, true);
+
+    pthread_create(&simulation, NULL, simulation_thread, &num_processes);
+    pthread_create(&renderer, NULL, render_thread, NULL);
+    pthread_join(simulation, NULL);
+    pthread_join(renderer, NULL);
+}
+
+// Start a run from time 0 with empty memory of the given size
+void reset_simulation(int memory_size) {
+    current_time = 0;
+    memset(&stats, 0, sizeof(stats));
+#ifdef OP_TIMING
+    memset(op_latency, 0, sizeof(op_latency));
+#endif
+#ifdef PHASE_TIMING
+    phase_timing_reset();
+#endif
+    waiting_queue_size = 0;
+    queue_sequence = 0;
+    allocated_count = 0;
+    free_memory();
+    initialize_memory(memory_size);
+}
+
+// Fill the process table with a reproducible trace of `jobs` processes
+// sized like create_sample_processes makes them, arriving at a rate that
+// keeps BENCH_MEMORY_SIZE about BENCH_LOAD_FACTOR full, so the run length
+// grows with the number of jobs instead of the waiting queue
+int generate_benchmark_trace(int jobs) {
+    // Mean size 105 MB and mean execution time 17.5 give the mean gap
+    int max_gap = (int)(2 * 105 * 17.5 / (BENCH_LOAD_FACTOR * BENCH_MEMORY_SIZE) + 0.5);
+    int arrival = 0;
+
+    reserve_processes(jobs);
+    memset(processes, 0, jobs * sizeof(Process));
+    srand(jobs);
+    for (int i = 0; i < jobs; i++) {
+        arrival += rand() % (max_gap + 1);
+        processes[i].pid = i + 1;
+        processes[i].size = rand() % 191 + 10;
+        processes[i].arrival_time = arrival;
+        processes[i].execution_time = rand() % 26 + 5;
+        processes[i].remaining_time = processes[i].execution_time;
+        processes[i].allocation_time = -1;
+        processes[i].memory_address = -1;
+        processes[i].completion_time = -1;
+        processes[i].queued_time = -1;
+    }
+    return jobs;
+}
+
+// Run the loaded processes to completion with no output and report the
+// run through `fd`. Runs in a child process, so it may change any state.
+static void benchmark_child(int jobs, CompactionTrigger trigger, QueuePolicy policy,
+                            BenchScheduling scheduling, int fd) {
+    BenchResult result = {0};
+    struct timespec start, end;
+    long long bound = 0;
+    int next_process = 0;
+
+    // Some process runs at every step until the last one completes, so
+    // the run cannot take longer than this unless it is stuck
+    for (int i = 0; i < jobs; i++) {
+        bound += processes[i].execution_time;
+    }
+    bound += jobs > 0 ? processes[jobs - 1].arrival_time + 1 : 0;
+
+    quiet = true;
+    fragmentation_log_enabled = false;
+    compaction_trigger = trigger;
+    queue_policy = policy;
+    backfilling_enabled = scheduling == BENCH_BACKFILL;
+    swap_wait_threshold = scheduling == BENCH_SWAP ? BENCH_SWAP_WAIT : 0;
+    process_count = jobs;
+    reset_simulation(BENCH_MEMORY_SIZE);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while ((next_process < jobs || allocated_count > 0 || waiting_queue_size > 0) && current_time < bound) {
+        admit_arrivals(&next_process, jobs);
+        simulate_time_step();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    result.seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    result.steps = current_time;
+    result.events = next_process + (long long)stats.successful_allocations + stats.completed_processes +
+                    stats.swap_outs + stats.compactions;
+    result.finished = current_time < bound || (allocated_count == 0 && waiting_queue_size == 0);
+    if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+// Fork a child to run one simulation and collect its result and peak RSS
+static bool benchmark_run(int jobs, CompactionTrigger trigger, QueuePolicy policy,
+                          BenchScheduling scheduling, BenchResult* result) {
+    struct rusage usage;
+    int status, fds[2];
+
+    fflush(stdout);
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        close(fds[0]);
+        benchmark_child(jobs, trigger, policy, scheduling, fds[1]);
+    }
+    close(fds[1]);
+    bool ok = child > 0 && read(fds[0], result, sizeof(*result)) == sizeof(*result);
+    close(fds[0]);
+    if (child > 0 && wait4(child, &status, 0, &usage) == child) {
+        result->peak_rss_kb = usage.ru_maxrss;
+    }
+    return ok;
+}
+
+// Headless end-to-end benchmark: every trace under every compaction
+// trigger, queue policy and scheduling mode, each in its own process.
+// Events/sec and wall time are means over the repetitions.
+//   tes3 bench [max generated jobs] [--reps N] [--json FILE]
+int run_benchmark(int argc, char* argv[]) {
+    const char* files[] = { "Input", "input2" };
+    const int generated[] = { 10000, 100000, 1000000 };
+    int max_jobs = BENCH_DEFAULT_MAX_JOBS, reps = 1;
+    const char* json_path = NULL;
+    FILE* json = NULL;
+    long long total_events = 0;
+    double total_seconds = 0;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (atoi(argv[i]) > 0) {
+            max_jobs = atoi(argv[i]);
+        } else {
+            fprintf(stderr, "Usage: tes3 bench [max generated jobs] [--reps N] [--json FILE]\n");
+            return 1;
+        }
+    }
+    if (reps < 1 || reps > BENCH_MAX_REPS) {
+        fprintf(stderr, "--reps must be between 1 and %d\n", BENCH_MAX_REPS);
+        return 1;
+    }
+    if (json_path != NULL && (json = fopen(json_path, "w")) == NULL) {
+        perror(json_path);
+        return 1;
+    }
+    if (json != NULL) {
+        fprintf(json, "{\n  \"benchmark\": \"simulation\",\n  \"reps\": %d,\n  \"results\": [", reps);
+    }
+
+    quiet = true;
+    printf("\n--- End-to-End Simulation Throughput (%d MB memory, %d repetition%s) ---\n",
+           BENCH_MEMORY_SIZE, reps, reps == 1 ? "" : "s");
+    printf("+-----------+-------------------------+---------------------+----------+----------+------------+--------------+----------+----------+\n");
+    printf("| Trace     | Compaction              | Queue policy        | Mode     | Jobs     | Steps      | Events/sec   | Wall (s) | RSS (MB) |\n");
+    printf("+-----------+-------------------------+---------------------+----------+----------+------------+--------------+----------+----------+\n");
+
+    int trace_count = 2 + (int)(sizeof(generated) / sizeof(generated[0]));
+    bool first_result = true;
+    for (int t = 0; t < trace_count; t++) {
+        char name[32];
+        int jobs;
+
+        if (t < 2) {
+            snprintf(name, sizeof(name), "%s", files[t]);
+            jobs = read_processes_from_file(files[t]);
+        } else {
+            if (generated[t - 2] > max_jobs) {
+                break;
+            }
+            snprintf(name, sizeof(name), "gen-%dk", generated[t - 2] / 1000);
+            jobs = generate_benchmark_trace(generated[t - 2]);
+        }
+        if (jobs <= 0) {
+            continue;
+        }
+
+        for (int trigger = COMPACT_NEVER; trigger <= COMPACT_INCREMENTAL; trigger++) {
+            for (int policy = 0; policy < QUEUE_POLICY_COUNT; policy++) {
+                for (int scheduling = 0; scheduling < BENCH_SCHEDULING_COUNT; scheduling++) {
+                    double samples[BENCH_MAX_REPS], rate = 0, seconds = 0;
+                    BenchResult result = {0};
+                    long peak_rss_kb = 0;
+
+                    for (int r = 0; r < reps; r++) {
+                        if (!benchmark_run(jobs, trigger, policy, scheduling, &result)) {
+                            fprintf(stderr, "Benchmark run failed\n");
+                            return 1;
+                        }
+                        samples[r] = result.seconds > 0 ? result.events / result.seconds : 0;
+                        rate += samples[r] / reps;
+                        seconds += result.seconds / reps;
+                        peak_rss_kb = result.peak_rss_kb > peak_rss_kb ? result.peak_rss_kb : peak_rss_kb;
+                        total_events += result.events;
+                        total_seconds += result.seconds;
+                    }
+                    printf("| %-9s | %-23s | %-19s | %-8s | %8d | %10lld | %12.0f | %8.3f | %8.1f |%s\n",
+                           name, compaction_trigger_name(trigger), queue_policy_names[policy],
+                           bench_scheduling_names[scheduling], jobs, result.steps, rate, seconds,
+                           peak_rss_kb / 1024.0, result.finished ? "" : " stuck");
+                    fflush(stdout);
+
+                    if (json != NULL) {
+                        fprintf(json, "%s\n    {\"trace\": \"%s\", \"compaction\": \"%s\", \"policy\": \"%s\", "
+                                      "\"scheduling\": \"%s\", \"jobs\": %d, \"steps\": %lld, \"events\": %lld, "
+                                      "\"seconds\": %.6f, \"peak_rss_kb\": %ld, \"events_per_sec\": [",
+                                first_result ? "" : ",", name, compaction_trigger_name(trigger),
+                                queue_policy_names[policy], bench_scheduling_names[scheduling], jobs,
+                                result.steps, result.events, seconds, peak_rss_kb);
+                        for (int r = 0; r < reps; r++) {
+                            fprintf(json, "%s%.1f", r > 0 ? ", " : "", samples[r]);
+                        }
+                        fprintf(json, "]}");
+                        first_result = false;
+                    }
+                }
+            }
+        }
+    }
+    printf("+-----------+-------------------------+---------------------+----------+----------+------------+--------------+----------+----------+\n");
+    printf("Overall: %.0f events/sec over %.3f s of simulation\n",
+           total_seconds > 0 ? total_events / total_seconds : 0.0, total_seconds);
+
+    if (json != NULL) {
+        fprintf(json, "\n  ],\n  \"overall_events_per_sec\": %.1f\n}\n",
+                total_seconds > 0 ? total_events / total_seconds : 0.0);
+        fclose(json);
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
+
+// Run the loaded processes with no output and check that no process is ever
+// allocated while it is still in the waiting queue and that every process
+// completes. Returns false with a message on the first violation.
+static bool swap_check_run(int jobs, const char* label) {
+    long long bound = 0;
+    int next_process = 0;
+
+    for (int i = 0; i < jobs; i++) {
+        bound += processes[i].execution_time;
+    }
+    bound += jobs > 0 ? processes[jobs - 1].arrival_time + 1 : 0;
+
+    process_count = jobs;
+    reset_simulation(CHECK_MEMORY_SIZE);
+    while ((next_process < jobs || allocated_count > 0 || waiting_queue_size > 0) && current_time < bound) {
+        admit_arrivals(&next_process, jobs);
+        simulate_time_step();
+        for (int i = 0; i < waiting_queue_size; i++) {
+            if (waiting_queue[i]->allocated) {
+                fprintf(stderr, "%s: Process %d is allocated and queued at time %d\n",
+                        label, waiting_queue[i]->pid, current_time);
+                return false;
+            }
+        }
+    }
+    if (stats.completed_processes != jobs || memory_used != 0) {
+        fprintf(stderr, "%s: %d of %d processes completed, %d MB still allocated at time %d\n",
+                label, stats.completed_processes, jobs, memory_used, current_time);
+        return false;
+    }
+    return true;
+}
+
+// Regression check for swapping: random traces sized like the generated
+// samples, all arriving early so the queue stays long, run with aggressive
+// swapping under every queue policy.
+//   tes3 check
+int run_swap_check() {
+    int failures = 0;
+
+    quiet = true;
+    fragmentation_log_enabled = false;
+    swap_wait_threshold = 2;
+    swap_min_residency = 1;
+    reserve_processes(CHECK_JOBS);
+
+    for (int policy = 0; policy < QUEUE_POLICY_COUNT; policy++) {
+        for (int seed = 1; seed <= CHECK_SEEDS; seed++) {
+            char label[64];
+            int arrival_counts[21] = {0};
+
+            // Counting sort by arrival time keeps the trace ordered
+            srand(seed);
+            memset(processes, 0, CHECK_JOBS * sizeof(Process));
+            for (int i = 0; i < CHECK_JOBS; i++) {
+                processes[i].arrival_time = rand() % 21;
+                arrival_counts[processes[i].arrival_time]++;
+            }
+            for (int i = 0, t = 0; t < 21; t++) {
+                while (arrival_counts[t]-- > 0) {
+                    processes[i].pid = i + 1;
+                    processes[i].arrival_time = t;
+                    processes[i].size = rand() % 191 + 10;
+                    processes[i].execution_time = rand() % 26 + 5;
+                    processes[i].remaining_time = processes[i].execution_time;
+                    processes[i].allocation_time = -1;
+                    processes[i].memory_address = -1;
+                    processes[i].completion_time = -1;
+                    processes[i].queued_time = -1;
+                    i++;
+                }
+            }
+
+            queue_policy = (QueuePolicy)policy;
+            snprintf(label, sizeof(label), "%s, seed %d", queue_policy_names[policy], seed);
+            bool passed = swap_check_run(CHECK_JOBS, label);
+            failures += !passed;
+            printf("%-36s %s (%d swap-outs)\n", label, passed ? "ok" : "FAILED", stats.swap_outs);
+        }
+    }
+    free_memory();
+    return failures > 0;
+}
+
+// Interactive menu for tuning how the simulation runs and is displayed
+void configure_settings() {
+    char input[20];
+
+    while (1) {
+        print_separator('-');
+        printf("%sSimulation Settings%s\n", COLOR_CYAN, COLOR_RESET);
+        printf("1. Memory map row limit (current: %d, 0 = no limit)\n", render_row_limit);
+        printf("2. Display mode (current: %s)\n",
+               display_mode == DISPLAY_DIFFERENTIAL ? "differential" : "full redraw");
+        printf("3. Render thread FPS (current: %d, 0 = render every step inline)\n", render_fps);
+        printf("4. Export fragmentation time series to %s (current: %s)\n",
+               FRAGMENTATION_LOG_FILE, fragmentation_log_enabled ? "on" : "off");
+        printf("5. Compaction trigger (current: %s)\n", compaction_trigger_name(compaction_trigger));
+        printf("6. Compaction copy rate (current: %d MB per time unit)\n", compaction_copy_rate);
+        printf("7. Swapping (current: %s)\n", swap_wait_threshold > 0 ? "on" : "off");
+        printf("8. EASY backfilling (current: %s)\n", backfilling_enabled ? "on" : "off");
+        printf("9. Waiting queue policy (current: %s)\n", queue_policy_names[queue_policy]);
+#ifdef PHASE_TIMING
+        printf("10. Export phase trace to %s (current: %s)\n",
+               PHASE_TRACE_FILE, phase_trace_enabled ? "on" : "off");
+#endif
+        printf("0. Back\n");
+        printf("Enter choice: ");
+        scanf("%s", input);
+
+        switch (atoi(input)) {
+            case 0:
+                return;
+            case 1: {
+                int limit;
+                printf("Rows before collapsing block runs: ");
+                scanf("%d", &limit);
+                if (limit < 0) {
+                    printf("%sInvalid row limit%s\n", COLOR_RED, COLOR_RESET);
+                    break;
+                }
+                render_row_limit = limit;
+                break;
+            }
+            case 2: {
+                int mode;
+                printf("Display mode (0 = full redraw, 1 = differential): ");
+                scanf("%d", &mode);
+                display_mode = mode == 1 ? DISPLAY_DIFFERENTIAL : DISPLAY_FULL_REDRAW;
+                break;
+            }
+            case 3: {
+                int fps;
+                printf("Frames per second (0-%d): ", MAX_RENDER_FPS);
+                scanf("%d", &fps);
+                if (fps < 0 || fps > MAX_RENDER_FPS) {
+                    printf("%sInvalid frame rate%s\n", COLOR_RED, COLOR_RESET);
+                    break;
+                }
+                render_fps = fps;
+                break;
+            }
+            case 4:
+                fragmentation_log_enabled = !fragmentation_log_enabled;
+                break;
+            case 5: {
+                int trigger;
+                printf("Compaction trigger (0 = never, 1 = on allocation failure, 2 = fragmentation threshold, 3 = periodic, 4 = incremental): ");
+                scanf("%d", &trigger);
+                if (trigger < COMPACT_NEVER || trigger > COMPACT_INCREMENTAL) {
+                    printf("%sInvalid trigger%s\n", COLOR_RED, COLOR_RESET);
+                    break;
+                }
+                if (trigger == COMPACT_ON_THRESHOLD) {
+                    double threshold;
+                    printf("Fragmentation index threshold (0-1): ");
+                    scanf("%lf", &threshold);
+                    if (threshold <= 0 || threshold > 1) {
+                        printf("%sInvalid threshold%s\n", COLOR_RED, COLOR_RESET);
+                        break;
+                    }
+                    compaction_threshold = threshold;
+                } else if (trigger == COMPACT_PERIODIC) {
+                    int period;
+                    printf("Compaction period (time units): ");
+                    scanf("%d", &period);
+                    if (period <= 0) {
+                        printf("%sInvalid period%s\n", COLOR_RED, COLOR_RESET);
+                        break;
+                    }
+                    compaction_period = period;
+                } else if (trigger == COMPACT_INCREMENTAL) {
+                    int budget;
+                    printf("MB moved per time step: ");
+                    scanf("%d", &budget);
+                    if (budget <= 0) {
+                        printf("%sInvalid budget%s\n", COLOR_RED, COLOR_RESET);
+                        break;
+                    }
+                    compaction_step_budget = budget;
+                }
+                compaction_trigger = (CompactionTrigger)trigger;
+                break;
+            }
+            case 6: {
+                int rate;
+                printf("Compaction copy rate (MB per time unit): ");
+                scanf("%d", &rate);
+                if (rate <= 0) {
+                    printf("%sInvalid copy rate%s\n", COLOR_RED, COLOR_RESET);
+                    break;
+                }
+                compaction_copy_rate = rate;
+                break;
+            }
+            case 7: {
+                int threshold, residency, rate;
+                printf("Waiting time before swapping others out (0 = no swapping): ");
+                scanf("%d", &threshold);
+                if (threshold < 0) {
+                    printf("%sInvalid waiting time%s\n", COLOR_RED, COLOR_RESET);
+                    break;
+                }
+                swap_wait_threshold = threshold;
+                if (threshold == 0) {
+                    break;
+                }
+                printf("Minimum run time before a process can be swapped out: ");
+                scanf("%d", &residency);
+                printf("Swap I/O rate (MB per time unit): ");
+                scanf("%d", &rate);
+                if (residency < 0 || rate <= 0) {
+                    printf("%sInvalid swap settings%s\n", COLOR_RED, COLOR_RESET);
+                    swap_wait_threshold = 0;
+                    break;
+                }
+                swap_min_residency = residency;
+                swap_io_rate = rate;
+                break;
+            }
+            case 8:
+                backfilling_enabled = !backfilling_enabled;
+                break;
+            case 9: {
+                int choice = 0;
+                for (int i = 0; i < QUEUE_POLICY_COUNT; i++) {
+                    printf("  %d. %s\n", i + 1, queue_policy_names[i]);
+                }
+                printf("Policy: ");
+                if (scanf("%d", &choice) != 1 || choice < 1 || choice > QUEUE_POLICY_COUNT) {
+                    printf("%sInvalid policy%s\n", COLOR_RED, COLOR_RESET);
+                    break;
+                }
+                queue_policy = (QueuePolicy)(choice - 1);
+                if (queue_policy == QUEUE_AGING) {
+                    double rate = 0;
+                    printf("Aging rate (priority per time unit waited, e.g. %.1f): ", DEFAULT_AGING_RATE);
+                    if (scanf("%lf", &rate) != 1 || rate < 0) {
+                        printf("%sInvalid aging rate%s\n", COLOR_RED, COLOR_RESET);
+                        break;
+                    }
+                    aging_rate = rate;
+                }
+                break;
+            }
+#ifdef PHASE_TIMING
+            case 10:
+                phase_trace_enabled = !phase_trace_enabled;
+                break;
+#endif
+            default:
+                printf("%sInvalid choice!%s\n", COLOR_RED, COLOR_RESET);
+        }
+    }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     char input[20];
     char filename[MAX_FILENAME_LENGTH];
     int num_processes = 10;
     int memory_size = 0;
     bool sim_initialized = false;
+    reserve_processes(MAX_PROCESSES);
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        return run_benchmark(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strcmp(argv[1], "check") == 0) {
+        return run_swap_check();
+    }
     display_welcome_screen();
 
     while (1) {
@@ -760,13 +3272,24 @@ int main() {
         printf("3. Save processes to file\n");
         printf("4. Set memory size\n");
         printf("5. Run simulation\n");
-        printf("6. Exit\n");
+        printf("6. Simulation settings\n");
+        printf("7. Exit\n");
         printf("Enter choice: ");
         scanf("%s", input);
 
-        if (strcmp(input, "6") == 0) {
+        if (strcmp(input, "7") == 0) {
             printf("Exiting...\n");
             free_memory();
+            free(frame.data);
+            free(screen_update.data);
+            free(screen.row_hash);
+            free_snapshot(&live_snapshot);
+            free_snapshot(&snapshots[0]);
+            free_snapshot(&snapshots[1]);
+            free(processes);
+            free(waiting_queue);
+            free(waiting_order);
+            free(allocated_processes);
             break;
         }
 
@@ -775,6 +3298,7 @@ int main() {
                 printf("Number of processes (max %d): ", MAX_PROCESSES);
                 scanf("%d", &num_processes);
                 Process* sample = create_sample_processes(num_processes);
+                reserve_processes(num_processes);
                 memcpy(processes, sample, num_processes * sizeof(Process));
                 free(sample);
                 printf("%sGenerated %d random processes%s\n", COLOR_GREEN, num_processes, COLOR_RESET);
@@ -783,7 +3307,7 @@ int main() {
             case 2: {
                 printf("Enter filename: ");
                 scanf("%s", filename);
-                num_processes = read_processes_from_file(filename, processes);
+                num_processes = read_processes_from_file(filename);
                 break;
             }
             case 3: {
@@ -816,13 +3340,11 @@ int main() {
                 }
 
                 // Initialize simulation state
-                current_time = 0;
-                memset(&stats, 0, sizeof(stats));
-                waiting_queue_size = 0;
-                allocated_count = 0;
-                memory_head->next = NULL;
-                memory_head->size = memory_size;
-                memory_head->is_free = true;
+                process_count = num_processes;
+                reset_simulation(memory_size);
+                if (fragmentation_log_enabled) {
+                    fragmentation_log_open(FRAGMENTATION_LOG_FILE);
+                }
 
                 // Run simulation
                 int step_mode = 0;
@@ -832,25 +3354,33 @@ int main() {
                 clock_t start = clock();
                 int current_process = 0;
 
-                while (current_process < num_processes || allocated_count > 0 || waiting_queue_size > 0) {
-                    clear_screen();
-                    display_simulation_header();
+                // Every frame is drawn by the renderer, so events go to its ring
+                bool threaded = render_fps > 0 && !step_mode;
+                reset_screen_state();
+                event_log_enabled = true;
+
+                if (threaded) {
+                    run_simulation_threaded(num_processes);
+                }
 
+                while (!threaded &&
+                       (current_process < num_processes || allocated_count > 0 || waiting_queue_size > 0)) {
                     // Add arriving processes
-                    while (current_process < num_processes && 
-                           processes[current_process].arrival_time <= current_time) {
-                        add_process(&processes[current_process]);
-                        current_process++;
-                    }
+                    admit_arrivals(&current_process, num_processes);
 
                     // Update simulation state
                     simulate_time_step();
-                    display_memory_state();
-                    display_allocated_processes();
+                    PHASE_TIMER_START(PHASE_RENDER);
+                    capture_snapshot(&live_snapshot, false);
+                    if (display_mode == DISPLAY_DIFFERENTIAL) {
+                        display_screen_differential(&live_snapshot, step_mode);
+                    } else {
+                        display_screen(&live_snapshot, step_mode);
+                    }
+                    PHASE_TIMER_STOP(PHASE_RENDER);
 
                     // Handle display timing
                     if (step_mode) {
-                        printf("Press ENTER to continue...");
                         while (getchar() != '\n'); 
                         getchar();
                     } else {
@@ -858,10 +3388,26 @@ int main() {
                     }
                 }
 
+                if (display_mode == DISPLAY_DIFFERENTIAL) {
+                    // Leave the cursor below the last frame
+                    printf("\033[%d;1H\033[?25h\n", screen.row_count + 1);
+                }
+                event_log_enabled = false;
+
                 stats.simulation_duration = (double)(clock() - start)/CLOCKS_PER_SEC;
+                record_policy_run();
                 display_simulation_stats();
+                fragmentation_log_close();
+#ifdef PHASE_TIMING
+                if (phase_trace_enabled) {
+                    phase_trace_write(PHASE_TRACE_FILE);
+                }
+#endif
                 break;
             }
+            case 6:
+                configure_settings();
+                break;
             default:
                 printf("%sInvalid choice!%s\n", COLOR_RED, COLOR_RESET);
         }